@@ -0,0 +1,50 @@
+/**
+* \file
+*
+* \brief The definition of CRC-16/CCITT for system packet and Flash data check
+*
+* Copyright (c) 2012-2014 Pervasive Displays Inc. All rights reserved.
+*
+*  Authors: Pervasive Displays Inc.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*  1. Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*  2. Redistributions in binary form must reproduce the above copyright
+*     notice, this list of conditions and the following disclaimer in
+*     the documentation and/or other materials provided with the
+*     distribution.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef CRC16_H_
+#define CRC16_H_
+
+#include <Pervasive_Displays_small_EPD.h>
+
+/** CRC-16/CCITT: polynomial 0x1021, initial value 0xFFFF, MSB first.
+ * \note Appending the CRC high byte first makes the CRC of whole packet 0 */
+#define CRC16_INITIAL_VALUE	0xFFFF
+
+#if (CRC16_TABLE_SIZE!=16) && (CRC16_TABLE_SIZE!=256)
+#error "CRC16_TABLE_SIZE must be 16 or 256"
+#endif
+
+uint16_t crc16_update(uint16_t crc,uint8_t data);
+uint16_t crc16_block(uint16_t crc,uint8_t *data,uint8_t len);
+
+#endif /* CRC16_H_ */
@@ -35,9 +35,137 @@
 #include "Uart_Driver.h"
 
 static receive_event_handler _RxEventHandle;
-uint8_t tx_buf[SERIAL_TX_MAX_LEN];
-static uint8_t tx_iptr;
-static uint8_t tx_optr;
+static uint8_t tx_buf[SERIAL_TX_MAX_LEN];
+/** The TX ring buffer indexes run freely. The put index is only written by
+ *  main loop and the get index is only written by TX interrupt. */
+static volatile uint8_t tx_put_index;
+static volatile uint8_t tx_get_index;
+static volatile uint8_t tx_in_progress;
+/** The handler is called once as the TX buffer has tx_notify_space bytes free */
+static transmit_space_handler _TxSpaceHandle;
+static uint8_t tx_notify_space;
+/** The low 16 bits of system ticks (32mSec) as the last byte was received
+ *  and put into TX buffer. The intervals checked are a few characters, an
+ *  older time may look recent only to wait a little longer. */
+static uint16_t rx_last_ticks;
+static uint16_t tx_last_ticks;
+/** The byte received as MCU clock switches, it is passed after the switch */
+static uint8_t rx_held_byte, rx_is_held;
+#if UART_RX_ISR_PROFILE
+static uint16_t rx_isr_max_cycles;
+#endif
+#if UART_LINK_STATISTICS
+link_statistics_t link_statistics;
+#endif
+
+/** \brief Set the divisor of 9600 baud rate for the SMCLK of MCU clock
+ */
+static void set_baud_rate(uint8_t MCU_clock) {
+	if (MCU_clock == MCU_CLOCK_RUN) {
+		UCA0BR0 = 0x82; // 16MHz 9600 ,UCA0BRx=1666
+		UCA0BR1 = 0x06; // 16MHz 9600
+		UCA0MCTL = UCBRS1 + UCBRS0; // Modulation UCBRSx =6
+	} else {
+		UCA0BR0 = 104; // 1MHz 9600
+		UCA0BR1 = 0;
+		UCA0MCTL = UCBRS0; // Modulation UCBRSx =1
+	}
+}
+
+/** \brief Read the byte of RX buffer
+ */
+static uint8_t read_rx_buffer(void) {
+	/** The overrun flag is cleared by reading UCA0RXBUF */
+	if (UCA0STAT & UCOE)
+		LINK_STATISTICS_COUNT(rx_overrun);
+	return UCA0RXBUF;
+}
+
+/** \brief Pass one received byte to the handler
+ *
+ * \note It is called by RX interrupt, or with interrupt disabled as the clock
+ *       switches, the byte in RX buffer is never lost by the reset of USCI.
+ */
+static void receive_byte(uint8_t data) {
+	if (_RxEventHandle != NULL)
+		_RxEventHandle(&data, 1);
+	rx_last_ticks = (uint16_t)get_system_ticks();
+}
+
+/** \brief Take the byte waiting in RX buffer while interrupt is disabled
+ */
+static void poll_rx_buffer(void) {
+	if (IFG2 & UCA0RXIFG)
+		receive_byte(read_rx_buffer());
+}
+
+/** \brief Wait until neither a byte is being sent nor received
+ *
+ * \note
+ * - It is called with interrupt disabled and returns in 4 characters
+ *   (4.2mSec) at most.
+ * - The TX buffer is held, the byte in TXBUF and the byte being shifted go
+ *   out in 2 characters. The bytes received meanwhile are taken.
+ * - The byte being received is read right after its stop bit and held
+ *   until the USCI is set for the new clock, the next start bit is half a
+ *   bit (52uSec) away at least.
+ */
+static void wait_byte_boundary(void) {
+	uint32_t start;
+	IE2 &= ~UCA0TXIE;
+	if ((uint16_t)((uint16_t)get_system_ticks() - tx_last_ticks) < 2 * UART_CHAR_TICKS) {
+		while (!(IFG2 & UCA0TXIFG))
+			poll_rx_buffer();
+		start = get_system_ticks();
+		while ((get_system_ticks() - start) < UART_CHAR_TICKS)
+			poll_rx_buffer();
+	}
+	/** The USCI is busy by receiving only */
+	start = get_system_ticks();
+	while ((UCA0STAT & UCBUSY) && !(IFG2 & UCA0RXIFG) &&
+	       (get_system_ticks() - start) < 2 * UART_CHAR_TICKS)
+		;
+	if (IFG2 & UCA0RXIFG) {
+		rx_held_byte = read_rx_buffer();
+		rx_is_held = TRUE;
+	}
+}
+
+/** \brief Set UART for the new MCU clock
+ *
+ * \note
+ * - It is called by set_MCU_clock with interrupt disabled, before and after
+ *   the DCO changes. The USCI is held in reset meanwhile.
+ * - MCU_CLOCK_WAIT is refused if UART isn't idle, the packet is received at
+ *   the current clock.
+ * - MCU_CLOCK_RUN waits for the boundary of bytes only, which is a few mSec
+ *   at most, so the delays of COG sequences don't overrun while the host
+ *   keeps sending, e.g. the bulk transfer or the commands of event mode.
+ * - The reset of USCI clears the interrupt enable bits, they are set again.
+ *
+ * \return FALSE if MCU_CLOCK_WAIT is refused
+ */
+static uint8_t data_interface_set_clock(uint8_t MCU_clock, uint8_t is_switched) {
+	if (!is_switched) {
+		poll_rx_buffer();
+		if (!data_interface_is_idle()) {
+			if (MCU_clock == MCU_CLOCK_WAIT)
+				return FALSE;
+			wait_byte_boundary();
+		}
+		UCA0CTL1 |= UCSWRST;
+		return TRUE;
+	}
+	set_baud_rate(MCU_clock);
+	UCA0CTL1 &= ~UCSWRST;
+	IE2 |= UCA0RXIE;
+	if (data_transmit_pending()) IE2 |= UCA0TXIE;
+	if (rx_is_held) {
+		rx_is_held = FALSE;
+		receive_byte(rx_held_byte);
+	}
+	return TRUE;
+}
 
 /** \brief Initialize the Rx event and start USB Device stack
  */
@@ -46,56 +174,144 @@ void data_interface_init(receive_event_handler OnRxEventHandle) {
 	P1SEL |= BIT1 + BIT2; // P1.1 = RXD, P1.2=TXD
 	P1SEL2 |= BIT1 + BIT2; // P1.1 = RXD, P1.2=TXD
 	UCA0CTL1 |= UCSSEL_2; // SMCLK
-	UCA0BR0 = 0x82; // 16MHz 9600 ,UCA0BRx=1666
-	UCA0BR1 = 0x06; // 16MHz 9600
-	UCA0MCTL = UCBRS1 + UCBRS0; // Modulation UCBRSx =6
+	set_baud_rate(get_MCU_clock());
 	UCA0CTL1 &= ~UCSWRST; // **Initialize USCI state machine**
 	IE2 |= UCA0RXIE; // Enable USCI_A0 RX interrupt
-	tx_iptr = 0;
-	tx_optr = 0;
+	set_MCU_clock_event(data_interface_set_clock);
+	tx_put_index = 0;
+	tx_get_index = 0;
+	tx_in_progress = FALSE;
+	_TxSpaceHandle = NULL;
+#if UART_LINK_STATISTICS
+	memset((uint8_t *)&link_statistics, 0, sizeof(link_statistics_t));
+#endif
+#if UART_RX_ISR_PROFILE
+	TA1CTL = TASSEL_2 + MC_2 + TACLR; // SMCLK, continuous mode for counting cycles
+	rx_isr_max_cycles = 0;
+#endif
 }
 
 void data_interface_detach(void) {
 	IE2 &= ~UCA0RXIE; //Disable USCI_A0 RX interrup
 }
 
+#if UART_RX_ISR_PROFILE
+/** \brief Get the worst-case SMCLK cycles of handling one received byte
+ *
+ * \note The interrupt entry and exit (about 11 cycles) are not included
+ */
+uint16_t get_rx_isr_max_cycles(void) {
+	return rx_isr_max_cycles;
+}
+#endif
+
+/** \brief Check whether UART is idle
+ *
+ * \note It is idle if no byte is being sent or received, the TX buffer is
+ *       empty and no byte is received for UART_RX_IDLE_MS.
+ *
+ * \return TRUE if UART is idle
+ */
+uint8_t data_interface_is_idle(void) {
+	uint16_t last_ticks;
+	unsigned short state = __get_interrupt_state();
+	__disable_interrupt();
+	last_ticks = rx_last_ticks;
+	__set_interrupt_state(state);
+	if ((UCA0STAT & UCBUSY) || data_transmit_pending() || tx_in_progress)
+		return FALSE;
+	return (uint16_t)((uint16_t)get_system_ticks() - last_ticks) >=
+	       (uint16_t)(UART_RX_IDLE_MS * SYSTEM_TICKS_PER_MS);
+}
+
+/** \brief Call the handler once when the TX buffer has free space
+ *
+ * \note
+ * - The handler is called by TX interrupt as the buffer drains to the space,
+ *   or right now if the space is already free. So the producer of a long
+ *   reply sleeps instead of polling the buffer.
+ * - The later call replaces the handler, NULL cancels it.
+ *
+ * \param space The number of free bytes, not larger than SERIAL_TX_MAX_LEN
+ * \param OnTxSpace The handler
+ */
+void data_transmit_notify(uint8_t space, transmit_space_handler OnTxSpace) {
+	unsigned short state = __get_interrupt_state();
+	__disable_interrupt();
+	if (OnTxSpace != NULL && (SERIAL_TX_MAX_LEN - data_transmit_pending()) >= space) {
+		_TxSpaceHandle = NULL;
+		__set_interrupt_state(state);
+		OnTxSpace();
+		return;
+	}
+	tx_notify_space = space;
+	_TxSpaceHandle = OnTxSpace;
+	__set_interrupt_state(state);
+}
+
+/** \brief Get the number of bytes are waiting in TX buffer
+ */
+uint8_t data_transmit_pending(void) {
+	return (uint8_t)(tx_put_index - tx_get_index);
+}
+
 /** \brief Transmit data to UART
+ *
+ * \note If TX buffer is full, it waits for TX interrupt to send out the
+ *       previous data rather than overwriting it.
  */
 void data_transmit(uint8_t *s, uint8_t len) {
-	tx_iptr=0;
-	tx_optr=0;
+	tx_in_progress = TRUE;
 	while (len--) {
-		tx_buf[tx_iptr] = *s++;
-		tx_iptr++;
-		tx_iptr &= (SERIAL_TX_MAX_LEN - 1);
-
+		if (data_transmit_pending() >= SERIAL_TX_MAX_LEN) {
+			LINK_STATISTICS_COUNT(tx_full);
+			while (data_transmit_pending() >= SERIAL_TX_MAX_LEN)
+				;
+		}
+		tx_buf[tx_put_index & (SERIAL_TX_MAX_LEN - 1)] = *s++;
+		tx_put_index++;
+		IE2 |= UCA0TXIE; // Enable USCI_A0 TX interrupt
 	}
-	IE2 |= UCA0TXIE; // Enable USCI_A0 TX interrupt
+	tx_in_progress = FALSE;
 }
 
 #pragma vector=USCIAB0RX_VECTOR
 __interrupt void USCI0RX_ISR(void) {
+#if UART_RX_ISR_PROFILE
+	uint16_t cycles = TA1R;
+#endif
 	//while (!(IFG2&UCA0RXIFG));				   // USCI_A0 TX buffer ready?
-	if (_RxEventHandle != NULL) {
-		_RxEventHandle((uint8_t *) &UCA0RXBUF, 1);
-	}
+	receive_byte(read_rx_buffer());
+#if UART_RX_ISR_PROFILE
+	cycles = TA1R - cycles;
+	if (cycles > rx_isr_max_cycles)
+		rx_isr_max_cycles = cycles;
+#endif
 	LPM3_EXIT;
 }
 
 // USCI A0/B0 Transmit ISR
 #pragma vector=USCIAB0TX_VECTOR
 __interrupt void USCI0TX_ISR(void) {
-	if (tx_iptr != tx_optr) {
+	if (tx_put_index != tx_get_index) {
 		if (IFG2 & UCA0TXIFG) // USCI_A0 TX buffer ready?
 		{
-			UCA0TXBUF = tx_buf[tx_optr];
-			tx_optr++;
-			tx_optr &= (SERIAL_TX_MAX_LEN - 1);
-			if (tx_optr == tx_iptr) {
-				IE2 &= ~UCA0TXIE; // Disable USCI_A0 TX interrupt
-			}
+			UCA0TXBUF = tx_buf[tx_get_index & (SERIAL_TX_MAX_LEN - 1)];
+			tx_get_index++;
+			tx_last_ticks = (uint16_t)get_system_ticks();
 		}
 	}
-
+	if (_TxSpaceHandle != NULL &&
+	    (SERIAL_TX_MAX_LEN - data_transmit_pending()) >= tx_notify_space) {
+		transmit_space_handler handler = _TxSpaceHandle;
+		_TxSpaceHandle = NULL;
+		handler();
+		LPM3_EXIT;
+	}
+	if (tx_put_index == tx_get_index) {
+		IE2 &= ~UCA0TXIE; // Disable USCI_A0 TX interrupt
+		/** The reply is still being put into buffer but UART goes idle */
+		if (tx_in_progress)
+			LINK_STATISTICS_COUNT(tx_underrun);
+	}
 }
-
@@ -34,23 +34,50 @@
 #ifndef __UART_H_
 #define __UART_H_
 
-#define   SERIAL_TX_MAX_LEN          16
-#define   SERIAL_RX_MAX_LEN          32
+/** The size of TX ring buffer */
+#define   SERIAL_TX_MAX_LEN          UART_TX_BUFFER_SIZE
+
+#if (SERIAL_TX_MAX_LEN & (SERIAL_TX_MAX_LEN-1)) || SERIAL_TX_MAX_LEN>128
+#error "UART_TX_BUFFER_SIZE must be power of 2 and not larger than 128"
+#endif
+
+/** The UART receiver is idle if no byte is received for 2 characters (2.1mSec
+ *  at 9600 baud), the bytes of a packet come back to back. */
+#define UART_RX_IDLE_MS		3
+
+/** The time of one character (10 bits at 9600 baud) in system ticks */
+#define UART_CHAR_TICKS		((uint32_t)1042 * SYSTEM_TICKS_PER_MS / 1000)
 
 /**
- * \brief UART serial buffer structure
+ * \brief The statistics of UART link
  */
 typedef struct
 {
-    uint8_t put_index,get_index;
-    uint8_t count;
-    char buffer[SERIAL_RX_MAX_LEN];
-} serial_buffer_t;
+    uint16_t rx_overflow;  /**< packets dropped for no free system packet buffer */
+    uint16_t rx_crc_error; /**< packets dropped for wrong CRC */
+    uint16_t rx_overrun;   /**< bytes lost by UART hardware overrun */
+    uint16_t tx_full;      /**< times of waiting for free TX buffer */
+    uint16_t tx_underrun;  /**< times of TX buffer ran empty in the middle of a packet */
+} link_statistics_t;
+
+#if UART_LINK_STATISTICS
+extern link_statistics_t link_statistics;
+#define LINK_STATISTICS_COUNT(name)	(link_statistics.name++)
+#else
+#define LINK_STATISTICS_COUNT(name)
+#endif
 
 typedef void (*receive_event_handler)(uint8_t *Rx_data,uint8_t len);
+typedef void (*transmit_space_handler)(void);
 
 void data_interface_init(receive_event_handler OnRxEventHandle);
 void data_transmit (uint8_t *s,uint8_t len);
+uint8_t data_transmit_pending(void);
+void data_transmit_notify(uint8_t space,transmit_space_handler OnTxSpace);
+uint8_t data_interface_is_idle(void);
 void data_interface_detach(void);
+#if UART_RX_ISR_PROFILE
+uint16_t get_rx_isr_max_cycles(void);
+#endif
 #endif
 
@@ -42,6 +42,31 @@ uint16_t image_count;
 uint8_t  line_count,rest_data_count;
 uint16_t address_offset;
 uint8_t slideshow_index;
+static scheduler_timer_t slideshow_timer; /**< the interval between slideshow images */
+static uint8_t update_event_mode;   /**< return the result of updating EPD by event */
+static uint32_t update_start_ticks; /**< the system ticks when updating EPD starts */
+
+/** The state of updating EPD without waiting */
+static uint8_t update_is_busy;
+static uint8_t update_result;       /**< the result of power on COG before updating */
+static long update_new_address;
+static uint8_t update_header, update_command; /**< command 0 is updated by slideshow */
+static uint16_t update_kit_id;
+static uint8_t update_coalesced;    /**< the number of requests replaced by this one */
+
+/** The show request waits for updating EPD, a new request replaces it */
+static uint8_t pending_is_valid;
+static uint8_t pending_header, pending_command;
+static uint16_t pending_kit_id;
+static uint8_t pending_coalesced;
+static uint8_t pending_data[sizeof(image_information_t)-4];
+
+/** The state of streaming Flash data to host */
+static long readback_address;
+static uint16_t readback_remaining;
+static uint8_t readback_line_size, readback_line_position;
+static uint8_t readback_header, readback_command;
+static uint16_t readback_kit_id;
 
 /** \brief Check the EPD extension board
  *
@@ -64,6 +89,421 @@ static void read_flash_handle(long flash_address,uint8_t *target_buffer,
 	read_flash(flash_address,target_buffer,byte_length);
 }
 
+/**
+ * \brief Write image data to Flash line by line
+ *
+ * \note
+ * - The image data continues from the last call. Each line of image is
+ *   written at the start of a Flash line (_flash_line_size).
+ * - The power session opened by clearing image stays open while loading.
+ *
+ * \param data The address pointer of image data
+ * \param len The length of image data
+ * \return TRUE
+ */
+static uint8_t load_image_data(uint8_t *data,uint8_t len) {
+	uint8_t tmp,tmp3=0;
+	int16_t tmp2;
+	EPD_session_touch();
+	tmp2=COG_parameters[image_info.EPD_size].horizontal_size;
+	line_count =len+address_offset;
+	rest_data_count =(uint8_t)(line_count%tmp2);
+	line_count =(uint8_t)(line_count/tmp2);
+	for(tmp=0; tmp<line_count; tmp++) {
+		write_flash((write_flash_address+address_offset),&data[tmp3],
+		            tmp2-address_offset);
+		write_flash_address+=_flash_line_size;
+		tmp3+=(tmp2-address_offset);
+		address_offset=0;
+	}
+
+	if(rest_data_count>0 && line_count>0) {
+		write_flash((write_flash_address+address_offset),
+		            &data[tmp3],rest_data_count);
+	} else if(rest_data_count>0) {
+		write_flash((write_flash_address+address_offset),
+		            &data[tmp3],(rest_data_count-address_offset));
+	}
+
+	address_offset=rest_data_count;
+	return TRUE;
+}
+
+/**
+ * \brief Get the flash address of an image slot of current EPD size
+ *
+ * \param slot The image slot information
+ * \return The address of image slot, _NULL_address if it is not available
+ */
+static long get_image_slot_address(image_slot_information_t *slot) {
+	if(image_info.EPD_size>EPD_270) return _NULL_address;
+	switch(slot->image_type) {
+	case Image_Slot_Previous:
+		return image_info.previous_image_address;
+	case Image_Slot_Custom:
+		return get_custom_image_address(image_info.EPD_size,slot->image_index,FALSE);
+	case Image_Slot_Slideshow:
+		return get_slideshow_image_address(image_info.EPD_size,slot->image_index,FALSE);
+	case Image_Slot_New:
+		return image_info.new_image_address;
+	}
+	return _NULL_address;
+}
+
+/**
+ * \brief Return CRC-16 of the lines of an image slot
+ *
+ * \param packet The system packet of command
+ * \param address The address of image slot
+ */
+static void return_image_crc(system_packets_t *packet,long address) {
+	uint16_t crc;
+	uint8_t buf[2];
+	epd_spi_attach();
+	crc=get_image_crc(address,COG_parameters[image_info.EPD_size].horizontal_size,
+	                  COG_parameters[image_info.EPD_size].vertical_size,read_flash_handle);
+	buf[0]=(uint8_t)(crc>>8);
+	buf[1]=(uint8_t)crc;
+	return_packets(packet,buf,2);
+}
+
+/**
+ * \brief Start streaming Flash data to host
+ *
+ * \param packet The system packet of command
+ * \param address The start address of Flash
+ * \param length The number of bytes to read
+ * \param line_size The bytes of each Flash line to read, 0=read continuously
+ */
+static void readback_start(system_packets_t *packet,long address,uint16_t length,
+                           uint8_t line_size) {
+	readback_header=packet->packet_header;
+	readback_kit_id=packet->kit_id;
+	readback_command=packet->command_type;
+	readback_address=address;
+	readback_line_size=line_size;
+	readback_line_position=0;
+	readback_remaining=length;
+	scheduler_post(EVENT_SPI_FLASH);
+}
+
+/**
+ * \brief Wake Flash readback up by TX interrupt as a packet fits in TX buffer
+ */
+static void readback_wake(void) {
+	scheduler_post(EVENT_SPI_FLASH);
+}
+
+/**
+ * \brief Send the next data packet of Flash readback
+ *
+ * \note
+ * - It is called by main loop. A data packet is sent only if TX buffer can
+ *   hold the whole packet, so it never waits and the UART keeps busy.
+ * - It runs again by readback_wake as the TX buffer drains, and the command
+ *   waiting in buffer is handled after the last packet.
+ * - The data packets have the maximum data length except the last one.
+ */
+static void poll_readback(void) {
+	system_packets_t packet;
+	uint8_t len=0,max,chunk;
+	if(readback_remaining==0) return;
+	if((SERIAL_TX_MAX_LEN-data_transmit_pending())<__System_Packet_Length_Max) {
+		data_transmit_notify(__System_Packet_Length_Max,readback_wake);
+		return;
+	}
+	max=__System_Packet_Length_Max-__System_Packet_Head_Size-__System_Packet_Check_Size(readback_header);
+	epd_spi_attach();
+	while(len<max && readback_remaining>0) {
+		chunk=max-len;
+		if(chunk>readback_remaining) chunk=(uint8_t)readback_remaining;
+		if(readback_line_size>0 && chunk>(readback_line_size-readback_line_position))
+			chunk=readback_line_size-readback_line_position;
+		read_flash(readback_address+readback_line_position,&packet.data[len],chunk);
+		len+=chunk;
+		readback_remaining-=chunk;
+		if(readback_line_size==0) {
+			readback_address+=chunk;
+		} else if((readback_line_position+=chunk)==readback_line_size) {
+			readback_line_position=0;
+			readback_address+=_flash_line_size;
+		}
+	}
+	packet.packet_header=readback_header;
+	packet.packet_length=__System_Packet_Head_Size+__System_Packet_Check_Size(readback_header)+len;
+	packet.kit_id=readback_kit_id;
+	packet.command_type=readback_command;
+	return_system_packets(&packet);
+	if(readback_remaining>0) data_transmit_notify(__System_Packet_Length_Max,readback_wake);
+	else scheduler_post(EVENT_UART_RX);
+}
+
+/**
+ * \brief Start updating EPD by a command
+ *
+ * \note The result returns immediately in event mode, the host can send
+ *       next commands while updating.
+ *
+ * \param packet The system packet of command
+ */
+static void update_begin(system_packets_t *packet) {
+	update_start_ticks=get_system_ticks();
+	if(update_event_mode) return_system_packet_result(packet,TRUE);
+}
+
+/**
+ * \brief Return the event that updating EPD is done
+ *
+ * \note The event packet is
+ *       | command type | error code | duration in mSec (4 bytes, LSB first) |
+ *       | number of requests replaced by this one |
+ *
+ * \param packet The system packet of command
+ * \param error RES_OK or the error code of COG driver
+ */
+static void return_update_event(system_packets_t *packet,uint8_t error) {
+	uint8_t event[7];
+	uint32_t duration;
+	duration=(get_system_ticks()-update_start_ticks)/SYSTEM_TICKS_PER_MS;
+	event[0]=packet->command_type;
+	event[1]=error;
+	memcpy(&event[2],(uint8_t *)&duration,4);
+	event[6]=update_coalesced;
+	packet->command_type=__Update_Event;
+	return_packets(packet,event,7);
+}
+
+/**
+ * \brief Finish updating EPD by a command
+ *
+ * \param packet The system packet of command
+ * \param error RES_OK or the error code of COG driver
+ */
+static void update_end(system_packets_t *packet,uint8_t error) {
+	if(update_event_mode) return_update_event(packet,error);
+	else return_system_packet_result(packet,TRUE);
+}
+
+/**
+ * \brief Return the result of command when updating EPD is done
+ *
+ * \param result RES_OK or the error code of COG driver
+ */
+static void update_done(uint8_t result) {
+	system_packets_t packet;
+	image_info.previous_image_address=update_new_address;
+	packet.packet_header=update_header;
+	packet.packet_length=__System_Packet_Head_Size+__System_Packet_Check_Size(update_header);
+	packet.kit_id=update_kit_id;
+	packet.command_type=update_command;
+	if(update_command!=__Reload_Current_Image) update_end(&packet,result);
+	else if(update_event_mode) return_update_event(&packet,result);
+}
+
+static void start_pending_update(void);
+
+/**
+ * \brief Proceed updating EPD until it is done
+ *
+ * \note It is called by main loop. The EPD driver writes a few lines each time.
+ */
+static void poll_update(void) {
+	uint8_t result;
+	if(!update_is_busy) return;
+	result=EPD_display_poll();
+	if(result==RES_BUSY) {
+		scheduler_post(EVENT_SPI_FLASH);
+		return;
+	}
+	update_is_busy=FALSE;
+	/** The commands waiting for updating can be handled now */
+	scheduler_post(EVENT_UART_RX);
+	if(update_result!=RES_OK) result=update_result;
+
+	/** Slideshow counts the interval after updating */
+	if(update_command==0) {
+		scheduler_timer_start(&slideshow_timer,(uint32_t)slideshow_parameter.interval*1000);
+		LED_Trigger();
+	} else update_done(result);
+	start_pending_update();
+}
+
+/**
+ * \brief Start updating EPD with new image from Flash without waiting
+ *
+ * \note
+ * - The COG driver is powered on by power session, which may have been
+ *   opened by clearing image or the last update. It is powered off when
+ *   it is idle for the idle timeout.
+ *
+ * \param header The packet header of command
+ * \param kit_id The kit ID of command
+ * \param command The command type, 0 for slideshow
+ * \param new_image_address The address of new image
+ */
+static void update_start(uint8_t header,uint16_t kit_id,uint8_t command,long new_image_address) {
+	update_result=EPD_session_open(image_info.EPD_size);
+	EPD_display_from_flash_Ex_start(image_info.EPD_size,image_info.previous_image_address,
+	                                new_image_address,read_flash_handle);
+	update_new_address=new_image_address;
+	update_coalesced=0;
+	update_header=header;
+	update_kit_id=kit_id;
+	update_command=command;
+	update_is_busy=TRUE;
+	scheduler_post(EVENT_SPI_FLASH);
+}
+
+/**
+ * \brief Start updating EPD by a show request which carries the image to show
+ *
+ * \note The request is passed by fields, the waiting request starts without
+ *       rebuilding a system packet on stack.
+ *
+ * \param header The packet header of request
+ * \param kit_id The kit ID of request
+ * \param command __Show_Index_Custom_Image or __Reload_Current_Image
+ * \param data The data of request
+ */
+static void update_request_start(uint8_t header,uint16_t kit_id,uint8_t command,
+                                 const uint8_t *data) {
+	update_start_ticks=get_system_ticks();
+	if(command==__Reload_Current_Image) {
+		update_start(header,kit_id,command,image_info.previous_image_address);
+		return;
+	}
+	memcpy ((uint8_t *)&image_info, data, sizeof(image_information_t)-4);
+	image_info.previous_image_address=image_info.extend_address.custom_image_address;
+	image_info.extend_address.custom_image_address= get_custom_image_address(image_info.EPD_size,image_info.image_index,FALSE);
+	update_start(header,kit_id,command,image_info.extend_address.custom_image_address);
+}
+
+/**
+ * \brief Keep the show request until updating EPD is done
+ *
+ * \note
+ * - A new show request replaces the waiting one, so only the latest image
+ *   is shown. A reload request doesn't replace the waiting show request
+ *   since it would show the same image.
+ * - In event mode, the result of each request has returned as it is queued
+ *   and the event of the request which replaced them reports the number of
+ *   them. Otherwise the host is still waiting for the result of the replaced
+ *   show request, __Result_Superseded returns for it.
+ *
+ * \param packet The system packet of show request
+ */
+static void update_queue(system_packets_t *packet) {
+	uint8_t header,command;
+	uint16_t kit_id;
+	if(pending_is_valid) {
+		pending_coalesced++;
+		if(packet->command_type==__Reload_Current_Image) {
+			return_system_packet_result(packet,TRUE);
+			return;
+		}
+	}
+	header=packet->packet_header;
+	kit_id=packet->kit_id;
+	command=packet->command_type;
+	if(pending_is_valid && !update_event_mode && pending_command!=__Reload_Current_Image) {
+		/** The data of new request is kept first, the packet is reused for
+		    the result of the replaced one */
+		memcpy(pending_data,(uint8_t *)&packet->data[0],sizeof(pending_data));
+		packet->packet_header=pending_header;
+		packet->kit_id=pending_kit_id;
+		packet->command_type=pending_command;
+		return_system_packet_result(packet,__Result_Superseded);
+		packet->packet_header=header;
+		packet->kit_id=kit_id;
+		packet->command_type=command;
+	} else memcpy(pending_data,(uint8_t *)&packet->data[0],sizeof(pending_data));
+	pending_header=header;
+	pending_kit_id=kit_id;
+	pending_command=command;
+	pending_is_valid=TRUE;
+	if(update_event_mode || packet->command_type==__Reload_Current_Image)
+		return_system_packet_result(packet,TRUE);
+}
+
+/**
+ * \brief Start the waiting show request after updating EPD is done
+ */
+static void start_pending_update(void) {
+	if(!pending_is_valid) return;
+	pending_is_valid=FALSE;
+	update_request_start(pending_header,pending_kit_id,pending_command,pending_data);
+	update_coalesced=pending_coalesced;
+	pending_coalesced=0;
+}
+
+/**
+ * \brief Check the command has to wait until updating EPD is done
+ *
+ * \note
+ * - The commands which drive EPD, power COG, erase or write Flash images
+ *   wait. The other commands are handled while updating, so no image is
+ *   rewritten while the update reads it line by line.
+ * - The commands on image slots wait too, the CRC of a whole image holds main
+ *   loop longer than a step of update, and the slots change as it is done.
+ * - The next readback waits until all data packets of the last one are sent.
+ *
+ * \param packet The system packet of command
+ * \return TRUE if the command waits
+ */
+static uint8_t is_command_deferred(system_packets_t *packet) {
+	if(packet==NULL) return FALSE;
+	/** The data packets of one readback are not mixed with the next one */
+	if(readback_remaining>0 &&
+	   (packet->command_type==__Read_Flash || packet->command_type==__Read_Image)) return TRUE;
+	if(!update_is_busy) return FALSE;
+	switch(packet->command_type) {
+	case __Clear_Image:
+	case __Clear_ASCII:
+	case __Clear_Custom_Image:
+	case __Clear_Slideshow_Image:
+	case __Load_Image:
+	case __Load_Encoded_Image:
+	case __Load_ASCII:
+	case __Load_Custom_Image:
+	case __Load_Slideshow_Image:
+	case __Bulk_Load_Image:
+	case __Bulk_Load_Encoded_Image:
+	case __Show_Image:
+	case __Show_ASCII:
+	case __Show_Custom_Image:
+	case __Show_Slideshow_Image:
+	case __Slideshow_On:
+	case __Slideshow_Off:
+	case __Clear_All_Flash:
+	case __Set_Temperature_Model:
+	case __SPI_Benchmark:
+	case __Batch_Commands:
+	case __Read_Image:
+	case __Get_Image_CRC:
+	case __Set_Reference_Image:
+		return TRUE;
+	case __Show_Index_Custom_Image:
+		/** The show request for the other EPD size doesn't replace the waiting one */
+		return (pending_is_valid && pending_command==__Show_Index_Custom_Image &&
+		        pending_data[0]!=packet->data[0]);
+	}
+	return FALSE;
+}
+
+/**
+ * \brief Check the result of command returns when updating EPD is done
+ *
+ * \note The result returns as the update starts in update event mode. The
+ *       result of __Reload_Current_Image always returns before updating.
+ *
+ * \param command_type The command type
+ * \return TRUE if the command updates EPD from Flash
+ */
+static uint8_t is_update_command(uint8_t command_type) {
+	return (command_type==__Show_Image || command_type==__Show_Custom_Image ||
+	        command_type==__Show_Slideshow_Image || command_type==__Show_Index_Custom_Image);
+}
+
 /**
  * \brief Execute slideshow function
  *
@@ -71,8 +511,6 @@ static void read_flash_handle(long flash_address,uint8_t *target_buffer,
  */
 static uint8_t slideshow_run(void) {
 
-	IE2 &= ~UCA0RXIE; //Disable USCI_A0 RX interrup
-	//IE2 &= ~UCA0TXIE; //Disable USCI_A0 TX interrup
 	image_info.EPD_size=slideshow_parameter.EPD_size;
 	image_info.image_index=slideshow_index;
 	/** Read new image */
@@ -88,9 +526,8 @@ static uint8_t slideshow_run(void) {
 
 	if(image_info.EPD_size>EPD_270) return 0;
 
-	/** Show image on EPD from Flash*/
-	EPD_display_from_flash(image_info.EPD_size,image_info.previous_image_address,
-	                       image_info.extend_address.custom_image_address,read_flash_handle);
+	/** Start showing image on EPD from Flash, the UART keeps receiving */
+	update_start(0,0,0,image_info.extend_address.custom_image_address);
 
 	image_info.extend_address.custom_image_address=_NULL_address;
 	slideshow_index++;
@@ -98,13 +535,147 @@ static uint8_t slideshow_run(void) {
 	/** Reset from beginning */
 	if(slideshow_index>slideshow_parameter.image_end_index)
 		slideshow_index=slideshow_parameter.image_start_index;
-	IE2 |= UCA0RXIE; // Enable USCI_A0 RX interrupt
-	//IE2 |= UCA0TXIE; // Enable USCI_A0 TX interrupt
-	//LED_OFF();
 	return 1;
 }
 
 
+static void uart_command_handle(system_packets_t * packet);
+
+/**
+ * \brief Execute the commands in batch packet one by one
+ *
+ * \note
+ * - The data of batch packet is a sequence of commands, each command is
+ *   | data length | command type | data |.
+ * - The commands stop at the first failure. The result packet returns
+ *   | TRUE if all commands succeeded | the number of succeeded commands |.
+ * - Batch and bulk transfer commands can't be in batch.
+ * - The commands which update EPD from Flash only start the update. The show
+ *   commands are accepted in update event mode only and the event returns
+ *   when it is done. The commands after them which wait for updating fail.
+ *
+ * \param packet The batch packet
+ */
+static void batch_command_handle(system_packets_t * packet) {
+	system_packets_t command;
+	uint8_t i=0,len,count=0,result=TRUE;
+	uint8_t data_length,check_size,tmp[2];
+	data_length=get_packet_data_length(packet);
+	check_size=__System_Packet_Check_Size(packet->packet_header);
+	capture_system_packet_result(TRUE);
+	while(i<data_length) {
+		len=packet->data[i];
+		if((i+2+len)>data_length || packet->data[i+1]==__Batch_Commands ||
+		   packet->data[i+1]==__Bulk_Load_Image || packet->data[i+1]==__Bulk_Load_Encoded_Image) {
+			result=FALSE;
+			break;
+		}
+		/** Rebuild the command as a system packet */
+		command.packet_header=packet->packet_header;
+		command.packet_length=__System_Packet_Head_Size+check_size+len;
+		command.kit_id=packet->kit_id;
+		command.command_type=packet->data[i+1];
+		memcpy((uint8_t *)&command.data[0],(uint8_t *)&packet->data[i+2],len);
+		/** The main loop never waits for updating, the result of update
+		    command wouldn't be known in batch */
+		if((!update_event_mode && is_update_command(command.command_type)) ||
+		   is_command_deferred(&command)) {
+			result=FALSE;
+			break;
+		}
+		uart_command_handle(&command);
+		if(get_captured_result()!=TRUE) {
+			result=FALSE;
+			break;
+		}
+		count++;
+		i+=2+len;
+	}
+	capture_system_packet_result(FALSE);
+	tmp[0]=result;
+	tmp[1]=count;
+	return_packets(packet,tmp,2);
+}
+
+/**
+ * \brief Start loading image by bulk transfer
+ *
+ * \note The image data follows this command as one bulk transfer. The result
+ *       returns after the data and CRC have been received.
+ *
+ * \param packet The system packet of command, the data is bulk_information_t
+ */
+static void bulk_load_start(system_packets_t *packet) {
+	bulk_information_t bulk_info;
+	memcpy ((uint8_t *)&bulk_info, (uint8_t *)&packet->data[0], sizeof(bulk_information_t));
+	if(image_info.EPD_size>EPD_270) {
+		return_system_packet_result(packet,FALSE);
+		return;
+	}
+	if(bulk_info.address!=_NULL_address) {
+		/** The image is loaded to the start of a slot which is erased first */
+		if(!is_image_slot_address(bulk_info.address,image_info.EPD_size)) {
+			return_system_packet_result(packet,FALSE);
+			return;
+		}
+		write_flash_address=bulk_info.address;
+		address_offset=0;
+		erase_image_background(write_flash_address,image_info.EPD_size);
+	}
+	/** The bulk data doesn't wait for erase, the ring would overflow */
+	flash_erase_wait();
+	image_count=0;
+	LED_Trigger();
+	return_system_packet_result(packet,
+	                            start_bulk_receive(packet,bulk_info.length,
+	                                    (packet->command_type==__Bulk_Load_Image) ?
+	                                    load_image_data : image_decoder_put));
+}
+
+/**
+ * \brief Return the active temperature model of EPD size
+ *
+ * \note The data of result packet is | TRUE if loaded from Flash | temperature model |.
+ *
+ * \param packet The system packet of command, the data is | EPD size |
+ */
+static void return_temperature_model(system_packets_t *packet) {
+	struct EPD_temperature_model_t model;
+	if(packet->data[0]>EPD_270) {
+		return_system_packet_result(packet,FALSE);
+		return;
+	}
+	packet->data[0]=EPD_get_temperature_model(packet->data[0],&model);
+	memcpy((uint8_t *)&packet->data[1],(uint8_t *)&model,sizeof(struct EPD_temperature_model_t));
+	packet->packet_length+=1+sizeof(struct EPD_temperature_model_t);
+	return_system_packets(packet);
+}
+
+/**
+ * \brief Store temperature model to Flash
+ *
+ * \note
+ * - The data of packet is | EPD size | temperature model |.
+ * - The invalid model erases the stored one, then the built-in model is used.
+ * - The COG driver loads the model again at next update.
+ *
+ * \param packet The system packet of command
+ */
+static void set_temperature_model(system_packets_t *packet) {
+	struct EPD_temperature_model_t model;
+	uint8_t result;
+	if(packet->data[0]>EPD_270 ||
+	   get_packet_data_length(packet)<1+sizeof(struct EPD_temperature_model_t)) {
+		return_system_packet_result(packet,FALSE);
+		return;
+	}
+	/** The model in packet isn't word aligned */
+	memcpy((uint8_t *)&model,(uint8_t *)&packet->data[1],sizeof(struct EPD_temperature_model_t));
+	result=write_temperature_model(packet->data[0],&model);
+	EPD_set_temperature_model_handler(read_temperature_model);
+	return_system_packet_result(packet,result);
+}
+
 /**
 * \brief Define UART command packet (system packet) and work flow by command type
 *
@@ -114,6 +685,12 @@ static void uart_command_handle(system_packets_t * packet) {
 	int16_t tmp2=0;
 	uint8_t tmp=0,tmp3=0;
 	ASCII_info_t tmp_ASCII_info;
+	image_slot_information_t tmp_slot_info;
+	readback_information_t tmp_readback_info;
+	long tmp_address;
+#if SPI_BENCHMARK
+	SPI_benchmark_t benchmark;
+#endif
 	switch(packet->command_type) {
 	case __Kit_ID:
 		packet->packet_length+=2; // return 2 data bytes
@@ -136,6 +713,59 @@ static void uart_command_handle(system_packets_t * packet) {
 		packet->data[0]=board_is_connected;
 		return_system_packets(packet);
 		break;
+	case __Link_Statistics:
+		/** return the counters of dropped packets and TX buffer waiting */
+#if UART_LINK_STATISTICS
+		return_packets(packet,(uint8_t *)&link_statistics,sizeof(link_statistics_t));
+#else
+		return_system_packet_result(packet,FALSE);
+#endif
+		break;
+	case __Protocol_Version:
+		packet->packet_length+=1; // return 1 data byte
+		packet->data[0]=__Protocol_Version_Max;
+		return_system_packets(packet);
+		break;
+	case __Update_Event_Mode:
+		/** TRUE: return result when EPD starts updating and event when it is done */
+		update_event_mode=packet->data[0];
+		return_system_packet_result(packet,TRUE);
+		break;
+	case __Temperature_Model:
+		return_temperature_model(packet);
+		break;
+	case __Set_Temperature_Model:
+		set_temperature_model(packet);
+		break;
+	case __Clock_Statistics:
+		/** Return the mSec at MCU_CLOCK_RUN and MCU_CLOCK_WAIT and the number of
+		    switches, the energy of update is estimated from the difference */
+#if MCU_CLOCK_SCALING && MCU_CLOCK_STATISTICS
+		return_packets(packet,(uint8_t *)get_MCU_clock_statistics(),sizeof(MCU_clock_statistics_t));
+#else
+		return_system_packet_result(packet,FALSE);
+#endif
+		break;
+	case __SPI_Benchmark:
+		/** Return the bytes/s of SPI clock, the transfer of each byte and the
+		    block transfer of the case in data[0] */
+#if SPI_BENCHMARK
+		if(epd_spi_benchmark(packet->data[0],&benchmark)) {
+			return_packets(packet,(uint8_t *)&benchmark,sizeof(SPI_benchmark_t));
+			break;
+		}
+#endif
+		return_system_packet_result(packet,FALSE);
+		break;
+	case __SPI_Bus_Statistics:
+		/** Return the attaches, skipped attaches and hardware initializations
+		    since the last update started */
+#if SPI_BUS_STATISTICS
+		return_packets(packet,(uint8_t *)get_SPI_bus_statistics(),sizeof(SPI_bus_statistics_t));
+#else
+		return_system_packet_result(packet,FALSE);
+#endif
+		break;
 	case __Firmware_Version:
 		packet->packet_length+=4; // return 4 data bytes
 		memcpy ((uint8_t *)&packet->data[0], (uint8_t *)Firmware_Version,4);
@@ -150,7 +780,7 @@ static void uart_command_handle(system_packets_t * packet) {
 	case __Clear_Slideshow_Image:
 		memcpy ((uint8_t *)&image_info, (uint8_t *)&packet->data[0], sizeof(image_information_t)-4);
 		get_flash_image_info(&image_info);
-		EPD_power_init(image_info.EPD_size);
+		EPD_session_open(image_info.EPD_size);
 		if(packet->command_type==__Clear_Image || packet->command_type==__Clear_ASCII) {
 			image_info.extend_address.mark_image_address= get_flash_mark_image_info(image_info.EPD_size);
 			write_flash_address=image_info.new_image_address;
@@ -165,6 +795,10 @@ static void uart_command_handle(system_packets_t * packet) {
 		}
 		image_count=image_info.number_of_images;
 		address_offset=0;
+		/** The delta-coded image refers to the image on EPD by default */
+		image_decoder_start(image_info.previous_image_address,
+		                    COG_parameters[image_info.EPD_size].horizontal_size,
+		                    load_image_data,read_flash_handle);
 		LED_Trigger();
 		//write image header to flash
 		write_mark(write_flash_address);
@@ -176,77 +810,84 @@ static void uart_command_handle(system_packets_t * packet) {
 		/** Deal with data packet as line data then as image data */
 		if(image_count>0) {
 			LED_Trigger();
-			tmp3=0;
-			tmp2=COG_parameters[image_info.EPD_size].horizontal_size;
-			line_count =(packet->packet_length-6)+address_offset; // -6 to remove packet header
-			rest_data_count =(uint8_t)(line_count%tmp2);
-			line_count =(uint8_t)(line_count/tmp2);
-		 for(tmp=0; tmp<line_count; tmp++) {
-				write_flash((write_flash_address+address_offset),(uint8_t *)&packet->data[tmp3],
-				            tmp2-address_offset);
-				write_flash_address+=_flash_line_size;
-				tmp3+=(tmp2-address_offset);
-				address_offset=0;
-			}
-
-			if(rest_data_count>0 && line_count>0) {
-				write_flash((write_flash_address+address_offset),
-				            (uint8_t *)&packet->data[tmp3],rest_data_count);
-			} else if(rest_data_count>0) {
-				write_flash((write_flash_address+address_offset),
-				            (uint8_t *)&packet->data[tmp3],(rest_data_count-address_offset));
-			}
-			
-			address_offset=rest_data_count;
-
+			load_image_data((uint8_t *)&packet->data[0],get_packet_data_length(packet));
 			if((--image_count)==0) {
 				return_system_packet_result(packet,TRUE);
 			}
 		}
 		break;
+	case __Load_Encoded_Image:
+		/** Deal with data packet as RLE or delta-coded data */
+		if(image_count>0) {
+			LED_Trigger();
+			tmp=image_decoder_put((uint8_t *)&packet->data[0],get_packet_data_length(packet));
+			if((--image_count)==0) {
+				return_system_packet_result(packet,tmp);
+			}
+		}
+		break;
+	case __Set_Reference_Image:
+		/** Return CRC-16 of reference image for host to check it is the same image.
+		    The image being written can not be reference */
+		memcpy ((uint8_t *)&tmp_slot_info, (uint8_t *)&packet->data[0], sizeof(image_slot_information_t));
+		tmp_address=get_image_slot_address(&tmp_slot_info);
+		if(tmp_address==_NULL_address || tmp_address==write_flash_address) {
+			return_system_packet_result(packet,FALSE);
+			break;
+		}
+		image_decoder_start(tmp_address,COG_parameters[image_info.EPD_size].horizontal_size,
+		                    load_image_data,read_flash_handle);
+		return_image_crc(packet,tmp_address);
+		break;
+	case __Bulk_Load_Image:
+	case __Bulk_Load_Encoded_Image:
+		bulk_load_start(packet);
+		break;
 	case __Load_ASCII:
 		memcpy ((uint8_t *)&tmp_ASCII_info, (uint8_t *)&packet->data[0], sizeof(ASCII_info_t));
+		EPD_session_touch();
 		write_ascii(image_info.new_image_address,image_info.extend_address.mark_image_address,
 		           tmp_ASCII_info.x,tmp_ASCII_info.y,(char *)&tmp_ASCII_info.str);
 		return_system_packet_result(packet,TRUE);
 		break;
 
 	case __Show_Image:
-		EPD_display_from_flash_Ex(image_info.EPD_size,image_info.previous_image_address,
-		                          image_info.new_image_address,read_flash_handle);
+		update_begin(packet);
+		update_start(packet->packet_header,packet->kit_id,packet->command_type,
+		             image_info.new_image_address);
 		image_info.extend_address.last_address=_NULL_address;
-		image_info.previous_image_address=image_info.new_image_address;
-		return_system_packet_result(packet,TRUE);
 		break;
 	case __Show_Custom_Image:
-		EPD_display_from_flash_Ex(image_info.EPD_size,image_info.previous_image_address,
-		                          image_info.extend_address.custom_image_address,read_flash_handle);
-		image_info.previous_image_address=image_info.extend_address.custom_image_address;
-		return_system_packet_result(packet,TRUE);
+		update_begin(packet);
+		update_start(packet->packet_header,packet->kit_id,packet->command_type,
+		             image_info.extend_address.custom_image_address);
 		break;
 	case __Show_Slideshow_Image:
-		EPD_display_from_flash_Ex(image_info.EPD_size,image_info.previous_image_address,
-		                          image_info.extend_address.slideshow_image_address,read_flash_handle);
-		image_info.previous_image_address=image_info.extend_address.slideshow_image_address;
-		return_system_packet_result(packet,TRUE);
+		update_begin(packet);
+		update_start(packet->packet_header,packet->kit_id,packet->command_type,
+		             image_info.extend_address.slideshow_image_address);
 		break;
 	case __Show_ASCII:
+		update_begin(packet);
 #if !(defined COG_V230_G2)
+		/** Power on COG again if the host paused longer than the idle timeout */
+		EPD_session_open(image_info.EPD_size);
 		EPD_display_partialupdate(image_info.EPD_size,image_info.previous_image_address,image_info.new_image_address,
 		                          image_info.extend_address.mark_image_address,read_flash_handle);
 		image_info.previous_image_address=image_info.new_image_address;
 		image_info.extend_address.last_address=_NULL_address;
 #endif
-		return_system_packet_result(packet,TRUE);
+		update_end(packet,RES_OK);
 		break;
 	case __Show_Index_Custom_Image:
-		memcpy ((uint8_t *)&image_info, (uint8_t *)&packet->data[0], sizeof(image_information_t)-4);
-		image_info.previous_image_address=image_info.extend_address.custom_image_address;
-		image_info.extend_address.custom_image_address= get_custom_image_address(image_info.EPD_size,image_info.image_index,FALSE);
-		EPD_display_from_flash(image_info.EPD_size,image_info.previous_image_address,
-		                       image_info.extend_address.custom_image_address,read_flash_handle);
-		image_info.previous_image_address=image_info.extend_address.custom_image_address;
-		return_system_packet_result(packet,TRUE);
+		/** The request waits if EPD is updating */
+		if(update_is_busy) {
+			update_queue(packet);
+			break;
+		}
+		if(update_event_mode) return_system_packet_result(packet,TRUE);
+		update_request_start(packet->packet_header,packet->kit_id,packet->command_type,
+		                     &packet->data[0]);
 		break;
 
 	case __Slideshow_On:
@@ -254,23 +895,30 @@ static void uart_command_handle(system_packets_t * packet) {
 		write_slideshow_parameters(&slideshow_parameter);
 		slideshow_index=slideshow_parameter.image_start_index;
 		LED_ON();
-		start_EPD_timer();
-		set_current_time_tick(slideshow_parameter.interval*1000);
+		scheduler_timer_start(&slideshow_timer,(uint32_t)slideshow_parameter.interval*1000);
+		scheduler_timer_expire(&slideshow_timer);
 		return_system_packet_result(packet,TRUE);
 		break;
 	case __Slideshow_Off:
 		slideshow_parameter.EPD_size=0x0;
 		slideshow_parameter.interval=0x0;
 		write_slideshow_parameters(&slideshow_parameter);
-		stop_EPD_timer();
+		scheduler_timer_stop(&slideshow_timer);
+		EPD_session_close();
 		epd_spi_detach ();
 		return_system_packet_result(packet,TRUE);
 		LED_OFF();
 		break;
 
 	case __Reload_Current_Image:
+		/** The result returns before updating, the event reports it is done */
+		if(update_is_busy) {
+			update_queue(packet);
+			break;
+		}
 		return_system_packet_result(packet,TRUE);
-		EPD_display_from_flash(image_info.EPD_size,image_info.previous_image_address,image_info.previous_image_address,read_flash_handle);
+		update_request_start(packet->packet_header,packet->kit_id,packet->command_type,
+		                     &packet->data[0]);
 		break;
 
 	case __Trigger_LED:
@@ -278,6 +926,36 @@ static void uart_command_handle(system_packets_t * packet) {
 		return_system_packet_result(packet,TRUE);
 		break;
 
+	case __Batch_Commands:
+		batch_command_handle(packet);
+		break;
+
+	case __Read_Flash:
+		/** Stream Flash data in data packets, no result packet but FALSE for no data */
+		memcpy ((uint8_t *)&tmp_readback_info, (uint8_t *)&packet->data[0], sizeof(readback_information_t));
+		if(tmp_readback_info.length==0) {
+			return_system_packet_result(packet,FALSE);
+			break;
+		}
+		readback_start(packet,tmp_readback_info.address,tmp_readback_info.length,0);
+		break;
+	case __Read_Image:
+	case __Get_Image_CRC:
+		/** Stream the lines of image slot, or return CRC-16 of them */
+		memcpy ((uint8_t *)&tmp_slot_info, (uint8_t *)&packet->data[0], sizeof(image_slot_information_t));
+		tmp_address=get_image_slot_address(&tmp_slot_info);
+		if(tmp_address==_NULL_address) {
+			return_system_packet_result(packet,FALSE);
+		} else if(packet->command_type==__Get_Image_CRC) {
+			return_image_crc(packet,tmp_address);
+		} else {
+			readback_start(packet,tmp_address,
+			               COG_parameters[image_info.EPD_size].horizontal_size*
+			               COG_parameters[image_info.EPD_size].vertical_size,
+			               COG_parameters[image_info.EPD_size].horizontal_size);
+		}
+		break;
+
 	case __Clear_All_Flash:
 		epd_spi_attach();
 		CMD_CE();
@@ -287,12 +965,89 @@ static void uart_command_handle(system_packets_t * packet) {
 	}
 }
 
+/**
+ * \brief Handle the received system packet unless it waits for updating EPD
+ */
+static void uart_task(void) {
+	/** The command which conflicts with updating EPD stays in buffer */
+	if(!is_command_deferred(peek_system_packet())) poll_system_packet_buffer();
+}
+
+/**
+ * \brief Run slideshow if interval has value and not zero
+ */
+static void slideshow_task(void) {
+	if(slideshow_parameter.interval>0 && slideshow_parameter.interval!=0xff && !update_is_busy &&
+	   !is_bulk_receiving()) {
+		if(scheduler_timer_is_due(&slideshow_timer)) {
+			slideshow_run();
+		}
+	}
+}
+
+/**
+ * \brief Power off COG driver if it is idle for the idle timeout
+ */
+static void session_task(void) {
+	EPD_session_poll();
+}
+
+/**
+ * \brief Abort the bulk transfer if the host stops sending in the middle
+ */
+static void bulk_timeout_task(void) {
+	poll_bulk_timeout();
+}
+
+/**
+ * \brief Start erasing the next sector as the erase in background proceeds
+ */
+static void erase_task(void) {
+	flash_erase_poll();
+}
+
+#if (defined COG_V110_G1)
+/**
+ * \brief Save the learned frame time while UART and EPD are idle
+ *
+ * \note Writing information memory disables interrupts for about 13mSec, the
+ *       bytes coming meanwhile would overrun the UART.
+ */
+static void frame_time_task(void) {
+	if(!update_is_busy && data_interface_is_idle()) EPD_save_frame_time();
+}
+#endif
+
+/**
+ * \brief Post timer event by EPD timer interrupt
+ */
+static void timer_event_handle(void) {
+	scheduler_post(EVENT_TIMER);
+}
+
+/** The tasks of EPD Kit Tool, the update of EPD runs first */
+static const scheduler_task_t kit_tool_tasks[]= {
+	{EVENT_SPI_FLASH, poll_update},
+	{EVENT_UART_RX,   uart_task},
+	{EVENT_SPI_FLASH, poll_readback},
+	{EVENT_TIMER,     slideshow_task},
+	{EVENT_TIMER,     session_task},
+	{EVENT_TIMER,     erase_task},
+	{EVENT_TIMER,     bulk_timeout_task},
+#if (defined COG_V110_G1)
+	{EVENT_TIMER,     frame_time_task},
+#endif
+};
+
 /**
  * \brief Initialize the UART data buffer, check extension board is connected and
  *        and check slideshow is enabled
  */
 void EPD_Kit_Tool_process_init(void) {
 	/** Initialize the UART data buffer and start receiving system packets */
+	scheduler_init(kit_tool_tasks,sizeof(kit_tool_tasks)/sizeof(scheduler_task_t));
+	set_EPD_timer_event(timer_event_handle);
+	EPD_set_temperature_model_handler(read_temperature_model);
 	data_controller_init(uart_command_handle);
 	delay_ms(1000);
 	check_EPD_extension_board();
@@ -304,27 +1059,14 @@ void EPD_Kit_Tool_process_init(void) {
 		if(slideshow_parameter.EPD_size>EPD_270) return;
 		if(slideshow_parameter.interval>0) {
 			LED_Trigger();
-			if(slideshow_run()) {
-				start_EPD_timer();
-				LED_ON();
-			}
+			if(slideshow_run()) LED_ON();
 		}
 	}
 }
 
 /**
- * \brief Polling system packet to data buffer
+ * \brief Run the tasks of posted events, or sleep until an event is posted
  */
 void EPD_Kit_tool_process_task(void) {
-
-	poll_system_packet_buffer();
-	/** Run slideshow if interval has value and not zero */
-	if(slideshow_parameter.interval>0 && slideshow_parameter.interval!=0xff) {
-		if(get_current_time_tick()>=(slideshow_parameter.interval*1000)) {
-			if(slideshow_run()) {
-				start_EPD_timer();
-				LED_Trigger();
-			}
-		}
-	}
+	scheduler_dispatch();
 }
@@ -62,6 +62,33 @@ typedef struct {
 	uint8_t    image_end_index;   /**< the end index of slideshow images */
 } slideshow_information_t;
 
+/**
+ * \brief Structure of the bulk transfer information  */
+typedef struct {
+	long       address;           /**< the start of image slot which is erased and loaded, -1=continue current image */
+	uint16_t   length;            /**< the number of image bytes follow the command */
+} bulk_information_t;
+
+/** The types of image slot for reference image, readback and CRC */
+#define Image_Slot_Previous        0 /**< the image is showing on EPD */
+#define Image_Slot_Custom          1
+#define Image_Slot_Slideshow       2
+#define Image_Slot_New             3 /**< the image is loaded by __Clear_Image */
+
+/**
+ * \brief Structure of the image slot information  */
+typedef struct {
+	uint8_t    image_type;        /**< the type of image slot */
+	uint8_t    image_index;       /**< the page index of custom or slideshow image */
+} image_slot_information_t;
+
+/**
+ * \brief Structure of the Flash readback information  */
+typedef struct {
+	long       address;           /**< the start address of Flash */
+	uint16_t   length;            /**< the number of bytes to read */
+} readback_information_t;
+
 #define Firmware_Version EPD_KIT_TOOL_VERSION
 #define KitID_Number     EPD_KIT_TOOL_ID
 
@@ -73,9 +100,20 @@ typedef struct {
 #define PAYLOAD_SIZE	64
 #endif
 
+#if !defined(UART_TX_BUFFER_SIZE)
+#define UART_TX_BUFFER_SIZE	32
+#endif
+
+#if !defined(CRC16_TABLE_SIZE)
+#define CRC16_TABLE_SIZE	16
+#endif
+
 #include "EPD_Led.h"
 #include "Char.h"
 #include "Mem_Flash.h"
+#include "Crc16.h"
+#include "Image_Decoder.h"
+#include "Scheduler.h"
 #include "Uart_Driver.h"
 #include "Uart_Controller.h"
 
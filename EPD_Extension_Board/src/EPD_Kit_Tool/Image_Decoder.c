@@ -0,0 +1,199 @@
+/**
+* \file
+*
+* \brief The decoder of compressed (RLE) and delta-coded image data
+*
+* Copyright (c) 2012-2014 Pervasive Displays Inc. All rights reserved.
+*
+*  Authors: Pervasive Displays Inc.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*  1. Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*  2. Redistributions in binary form must reproduce the above copyright
+*     notice, this list of conditions and the following disclaimer in
+*     the documentation and/or other materials provided with the
+*     distribution.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "EPD_Kit_Tool_Process.h"
+
+/**
+ * \brief Structure of the state of image decoder  */
+typedef struct {
+	long     reference_address; /**< the line address of reference image, negative=no reference */
+	uint16_t run;               /**< the remaining bytes of fill or RLE run */
+	uint8_t  line_size;         /**< the bytes of a line */
+	uint8_t  op;                /**< the operation of current record */
+	uint8_t  lines;             /**< the remaining lines of current record */
+	uint8_t  position;          /**< the byte position of current line */
+	uint8_t  stage;             /**< the byte expected by current record */
+	uint8_t  error;             /**< invalid data has been received */
+} image_decoder_t;
+
+static image_decoder_t decoder;
+static image_data_handler _image_data_handler;
+static EPD_read_flash_handler _read_flash_handler;
+
+/**
+ * \brief Write the bytes of output buffer
+ *
+ * \param out The output buffer
+ * \param len The address of the number of bytes in output buffer
+ */
+static void decoder_flush(uint8_t *out,uint8_t *len) {
+	if(*len==0) return;
+	if(!_image_data_handler(out,*len)) decoder.error=1;
+	*len=0;
+}
+
+/**
+ * \brief Append a decoded byte, the line is written when it is complete
+ *
+ * \param out The output buffer
+ * \param len The address of the number of bytes in output buffer
+ * \param value The decoded byte
+ */
+static void decoder_output(uint8_t *out,uint8_t *len,uint8_t value) {
+	out[(*len)++]=value;
+	if((++decoder.position)==decoder.line_size) {
+		decoder.position=0;
+		decoder.reference_address+=_flash_line_size;
+		decoder_flush(out,len);
+		if((--decoder.lines)==0) decoder.stage=Decoder_Stage_Op;
+	}
+}
+
+/**
+ * \brief Copy the lines of current record from reference image
+ *
+ * \param out The output buffer of one line at least
+ */
+static void decoder_copy_lines(uint8_t *out) {
+	if(decoder.reference_address<0) {
+		decoder.error=1;
+		return;
+	}
+	while(decoder.lines>0) {
+		_read_flash_handler(decoder.reference_address,out,decoder.line_size);
+		if(!_image_data_handler(out,decoder.line_size)) decoder.error=1;
+		decoder.reference_address+=_flash_line_size;
+		decoder.lines--;
+	}
+}
+
+/**
+ * \brief Start decoding a new image
+ *
+ * \param reference_address The flash address of reference image, _NULL_address=none
+ * \param line_size The bytes of a line
+ * \param OnImageData The handler to write decoded data
+ * \param OnReadFlash The handler to read reference image
+ */
+void image_decoder_start(long reference_address,uint8_t line_size,
+                         image_data_handler OnImageData,EPD_read_flash_handler OnReadFlash) {
+	decoder.reference_address=reference_address;
+	decoder.line_size=line_size;
+	decoder.lines=0;
+	decoder.position=0;
+	decoder.stage=Decoder_Stage_Op;
+	decoder.error=(line_size==0 || line_size>__Decoder_Line_Max);
+	_image_data_handler=OnImageData;
+	_read_flash_handler=OnReadFlash;
+}
+
+/**
+ * \brief Decode a piece of encoded data and write the decoded lines
+ *
+ * \note The records can be split at any byte between pieces.
+ *
+ * \param data The address pointer of encoded data
+ * \param len The length of encoded data
+ * \return FALSE if any invalid data has been received since start
+ */
+uint8_t image_decoder_put(uint8_t *data,uint8_t len) {
+	uint8_t out[__Decoder_Line_Max];
+	uint8_t out_len=0;
+	uint8_t value;
+	if(decoder.error) return FALSE;
+	while(len--) {
+		value=*data++;
+		switch(decoder.stage) {
+		case Decoder_Stage_Op:
+			decoder.op=value & __Encoding_Op_Mask;
+			decoder.lines=(value & __Encoding_Count_Mask)+1;
+			if(decoder.op==__Encoding_Copy) {
+				decoder_copy_lines(out);
+			} else if(decoder.op==__Encoding_Fill) {
+				decoder.run=(uint16_t)decoder.lines*decoder.line_size;
+				decoder.stage=Decoder_Stage_Value;
+			} else if(decoder.op==__Encoding_RLE) {
+				decoder.stage=Decoder_Stage_Run;
+			} else {
+				decoder.stage=Decoder_Stage_Data;
+			}
+			break;
+		case Decoder_Stage_Data:
+			decoder_output(out,&out_len,value);
+			break;
+		case Decoder_Stage_Run:
+			decoder.run=(value==0) ? 256 : value;
+			decoder.stage=Decoder_Stage_Value;
+			break;
+		case Decoder_Stage_Value:
+			while(decoder.run>0 && decoder.lines>0) {
+				decoder.run--;
+				decoder_output(out,&out_len,value);
+			}
+			/** The run is longer than the rest of the record */
+			if(decoder.run>0) decoder.error=1;
+			else if(decoder.lines>0) decoder.stage=Decoder_Stage_Run;
+			break;
+		}
+	}
+	decoder_flush(out,&out_len);
+	return (decoder.error==0);
+}
+
+/**
+ * \brief Get CRC-16 of an image in flash to identify it
+ *
+ * \param image_address The flash address of image
+ * \param line_size The bytes of a line
+ * \param lines The number of lines
+ * \param OnReadFlash The handler to read image
+ * \return CRC-16/CCITT of all lines
+ */
+uint16_t get_image_crc(long image_address,uint8_t line_size,uint16_t lines,
+                       EPD_read_flash_handler OnReadFlash) {
+	uint8_t buf[__Decoder_CRC_Chunk];
+	uint8_t i,chunk;
+	uint16_t crc=CRC16_INITIAL_VALUE;
+	if(line_size>__Decoder_Line_Max) line_size=__Decoder_Line_Max;
+	while(lines--) {
+		/** A line is read in small chunks to save stack */
+		for(i=0; i<line_size; i+=chunk) {
+			chunk=line_size-i;
+			if(chunk>__Decoder_CRC_Chunk) chunk=__Decoder_CRC_Chunk;
+			OnReadFlash(image_address+i,buf,chunk);
+			crc=crc16_block(crc,buf,chunk);
+		}
+		image_address+=_flash_line_size;
+	}
+	return crc;
+}
@@ -0,0 +1,84 @@
+/**
+* \file
+*
+* \brief The decoder of compressed (RLE) and delta-coded image data
+*
+* Copyright (c) 2012-2014 Pervasive Displays Inc. All rights reserved.
+*
+*  Authors: Pervasive Displays Inc.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*  1. Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*  2. Redistributions in binary form must reproduce the above copyright
+*     notice, this list of conditions and the following disclaimer in
+*     the documentation and/or other materials provided with the
+*     distribution.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef IMAGE_DECODER_H_
+#define IMAGE_DECODER_H_
+
+#include <Pervasive_Displays_small_EPD.h>
+
+/******************************************************************************
+ * \brief The encoding of compressed and delta-coded image data
+ *
+ * \note
+ * - The encoded data is a sequence of records. Each record starts with an
+ *   operation byte, bit7-6 is the operation and bit5-0 is the number of
+ *   lines minus one (1~64 lines).
+ * - Raw:  followed by the bytes of the lines
+ * - Copy: the lines are copied from reference image, no following byte
+ * - Fill: followed by one byte, all bytes of the lines are the same
+ * - RLE:  followed by (run length, value) pairs until the lines are
+ *   complete, run length 0 means 256 bytes
+ * - The reference image advances line by line together with the new image,
+ *   so only the changed lines need to be sent for delta coding.
+ */
+#define __Encoding_Raw          0x00
+#define __Encoding_Copy         0x40
+#define __Encoding_Fill         0x80
+#define __Encoding_RLE          0xC0
+#define __Encoding_Op_Mask      0xC0
+#define __Encoding_Count_Mask   0x3F
+
+/** The maximum bytes of a line, 2.7" is 264 pixels=33 bytes */
+#define __Decoder_Line_Max      33
+
+/** The bytes read from Flash at a time by get_image_crc */
+#define __Decoder_CRC_Chunk     8
+
+/** The states of decoding a record */
+enum
+{
+	Decoder_Stage_Op = 0,
+	Decoder_Stage_Data,
+	Decoder_Stage_Run,
+	Decoder_Stage_Value
+};
+
+typedef uint8_t (*image_data_handler)(uint8_t *data,uint8_t len);
+
+void image_decoder_start(long reference_address,uint8_t line_size,
+                         image_data_handler OnImageData,EPD_read_flash_handler OnReadFlash);
+uint8_t image_decoder_put(uint8_t *data,uint8_t len);
+uint16_t get_image_crc(long image_address,uint8_t line_size,uint16_t lines,
+                       EPD_read_flash_handler OnReadFlash);
+
+#endif /* IMAGE_DECODER_H_ */
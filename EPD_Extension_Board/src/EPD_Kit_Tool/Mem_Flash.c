@@ -36,12 +36,21 @@
 
 static uint8_t Mark_Random_Index=0;
 
+/** The sectors from erase_address to erase_end are erased in background */
+static long erase_address;
+static long erase_end;
+static uint8_t erase_is_started;   /**< the sector of erase_address is erasing */
+static uint8_t suspend_is_supported=TRUE;
+static uint32_t erase_resume_us;   /**< the system uSec as erase resumed */
+
 /**
- * \brief Set Flash_CS pin to high and EPD_CS to low
+ * \brief Set Flash_CS pin to high
+ *
+ * \note EPD_CS stays high, the COG may be kept powered on by power session.
+ *       EPD_CS is parked low by the power off sequence of COG driver.
  */
 void Flash_cs_high(void) {
 	EPD_flash_cs_high();
-	EPD_cs_low ();
 }
 
 /**
@@ -123,16 +132,88 @@ static uint8_t IsFlashBusy( void ) {
 		return 0;
 }
 
+/**
+ * \brief Read security register
+ *
+ * \return Register status
+ */
+static uint8_t CMD_RDSCUR(void) {
+	uint8_t	gDataBuffer;
+
+	Flash_cs_low();
+	send_byte( FLASH_CMD_RDSCUR );
+	gDataBuffer = get_byte();
+	Flash_cs_high();
+
+	return gDataBuffer;
+}
+
+/**
+ * \brief Check if the Flash range is erased in background
+ *
+ * \param flash_address The start address of Flash
+ * \param byte_length The data length
+ * \return TRUE if the range overlaps the sectors which are not erased yet
+ */
+static uint8_t is_erasing(long flash_address, long byte_length) {
+	return (erase_address<erase_end && flash_address<erase_end &&
+	        (flash_address+byte_length)>erase_address);
+}
+
+/**
+ * \brief Suspend the erase in background for reading the other sectors
+ *
+ * \note
+ * - The Flash which ignores the suspend command is known by WIP which doesn't
+ *   clear, the erase is never suspended after then.
+ * - WIP may clear because the erase is done, the security register tells.
+ *
+ * \return TRUE if the erase is suspended and has to be resumed
+ */
+static uint8_t suspend_erase(void) {
+	uint32_t start;
+	if(!erase_is_started || !suspend_is_supported || !IsFlashBusy()) return FALSE;
+	/** Let the erase progress between reads back to back */
+	while((get_system_us()-erase_resume_us)<FLASH_RESUME_SUSPEND_US);
+
+	Flash_cs_low();
+	send_byte( FLASH_CMD_PES );
+	Flash_cs_high();
+	start=get_system_us();
+	while(IsFlashBusy()) {
+		if((get_system_us()-start)>=FLASH_SUSPEND_TIMEOUT_US) {
+			suspend_is_supported=FALSE;
+			return FALSE;
+		}
+	}
+	return (CMD_RDSCUR() & FLASH_ESB_MASK)!=0;
+}
+
+/**
+ * \brief Resume the erase which is suspended by suspend_erase
+ */
+static void resume_erase(void) {
+	Flash_cs_low();
+	send_byte( FLASH_CMD_PER );
+	Flash_cs_high();
+	erase_resume_us=get_system_us();
+}
+
 /**
  * \brief Read Flash data into buffer
  *
+ * \note The erase in background is suspended during the read, so the read
+ *       doesn't wait for it unless the data is in the erasing sectors.
+ *
  * \param flash_address The start address of Flash
  * \param target_buffer The target address of buffer will be read
  * \param byte_length The data length will be read
  */
 static void flash_cmd_read( long flash_address, uint8_t *target_buffer, long byte_length ) {
-	long index;
-	while( IsFlashBusy());
+	uint8_t suspended;
+	if(is_erasing(flash_address,byte_length)) flash_erase_wait();
+	suspended=suspend_erase();
+	if(!suspended) while( IsFlashBusy());
 	/** Chip select go low to start a flash command */
 	Flash_cs_low();
 
@@ -142,14 +223,12 @@ static void flash_cmd_read( long flash_address, uint8_t *target_buffer, long byt
 	send_flash_address( flash_address );
 	send_byte(0);
 
-	/** Set a loop to read data into buffer */
-	for( index=0; index < byte_length; index++ ) {
-		// Read one data byte at a time
-		*(target_buffer + index) = get_byte();
-	}
+	/** Read data into buffer continuously */
+	epd_spi_read_block(target_buffer,(uint16_t)byte_length,0);
 
 	/** Chip select go high to end a flash command */
 	Flash_cs_high();
+	if(suspended) resume_erase();
 }
 
 /**
@@ -221,7 +300,7 @@ static void CMD_WREN( void ) {
  * \param byte_length The data length will be read
  */
 static void CMD_PP( long flash_address, uint8_t *source_address, uint8_t byte_length ) {
-	long index;
+	if(is_erasing(flash_address,byte_length)) flash_erase_wait();
 	while( IsFlashBusy()) _NOP();
 	// Setting Write Enable Latch bit
 	CMD_WREN();
@@ -233,11 +312,9 @@ static void CMD_PP( long flash_address, uint8_t *source_address, uint8_t byte_le
 	send_byte( FLASH_CMD_PP );
 	send_flash_address( flash_address);
 
-	// Set a loop to download whole page data into flash's buffer
+	// Download whole page data into flash's buffer continuously
 	// Note: only last 256 byte will be programmed
-	for( index=0; index < byte_length; index++ ) {
-		send_byte( *(source_address + index) );
-	}
+	epd_spi_write_block( source_address, byte_length );
 
 	// Chip select go high to end a flash command
 	Flash_cs_high();
@@ -281,6 +358,9 @@ void CMD_CE(void) {
 	// Chip select go high to end a flash command
 	Flash_cs_high();
 	while( IsFlashBusy());
+	// The erase in background is done by chip erase
+	erase_address=erase_end;
+	erase_is_started=FALSE;
 
 }
 
@@ -311,6 +391,16 @@ void write_flash(long flash_address,uint8_t *source_address, uint8_t byte_length
 }
 
 
+/**
+ * \brief Get the number of sectors of an image
+ *
+ * \param EPD_size The EPD size
+ * \return 2 sectors (8 kbytes) of 1.44" and 2", 3 sectors (12 kbytes) of 2.7"
+ */
+static uint8_t get_image_sectors(uint8_t EPD_size) {
+	return (EPD_size==EPD_270) ? 3 : 2;
+}
+
 /**
  * \brief To erase the image data
  *
@@ -318,24 +408,100 @@ void write_flash(long flash_address,uint8_t *source_address, uint8_t byte_length
  * \param EPD_size The EPD size
  */
 void erase_image(long address,uint8_t EPD_size) {
-	uint8_t i,multiple_of_image_size=2;
+	uint8_t i,multiple_of_image_size=get_image_sectors(EPD_size);
 
+	for(i=0; i<multiple_of_image_size; i++) {
+		CMD_SE(address); //Erase data of the chosen sector
+		address+=_flash_sector_size; //4K
+		//delay_ms(300);
+	}
+}
+
+/**
+ * \brief Check the address is the start of an image slot of the EPD size
+ *
+ * \note The image, marked image, slideshow and custom slots of each EPD size
+ *       are contiguous pages of the image size.
+ *
+ * \param address The Flash address
+ * \param EPD_size The EPD size
+ * \return TRUE if the address is the start of a slot
+ */
+uint8_t is_image_slot_address(long address,uint8_t EPD_size) {
+	long start,end,page_size;
 	switch(EPD_size) {
 	case EPD_144:
-		multiple_of_image_size=2; // 8 kbytes
+		start=_image144_SOF;
+		end=_image200_SOF;
+		page_size=_page_size_144_200;
 		break;
 	case EPD_200:
-		multiple_of_image_size=2; // 8 kbytes
+		start=_image200_SOF;
+		end=_image270_SOF;
+		page_size=_page_size_144_200;
 		break;
 	case EPD_270:
-		multiple_of_image_size=3; // 12kbytes
+		start=_image270_SOF;
+		end=_image270_custom_address(_image270_custom_page_max);
+		page_size=_page_size_270;
 		break;
+	default:
+		return FALSE;
 	}
-	for(i=0; i<multiple_of_image_size; i++) {
-		CMD_SE(address); //Erase data of the chosen sector
-		address+=_flash_sector_size; //4K
-		//delay_ms(300);
+	if(address<start || address>=end) return FALSE;
+	return ((address-start)%page_size)==0;
+}
+
+/**
+ * \brief Start erasing the image data in background without waiting
+ *
+ * \note
+ * - The sectors are erased one by one by flash_erase_poll. The reads of the
+ *   other sectors suspend the erase, the reads and writes of the erasing
+ *   sectors wait until they are erased.
+ * - The erase in background which isn't done yet is finished first.
+ *
+ * \param address The start address to be erased
+ * \param EPD_size The EPD size
+ */
+void erase_image_background(long address,uint8_t EPD_size) {
+	flash_erase_wait();
+	erase_address=address;
+	erase_end=address+get_image_sectors(EPD_size)*_flash_sector_size;
+	flash_erase_poll();
+}
+
+/**
+ * \brief Proceed the erase in background, the next sector is started as the
+ *        previous one is done
+ *
+ * \note It is called periodically by main loop.
+ *
+ * \return TRUE if the erase in background isn't done yet
+ */
+uint8_t flash_erase_poll(void) {
+	if(erase_address>=erase_end) return FALSE;
+	epd_spi_attach();
+	if(IsFlashBusy()) return TRUE;
+	if(erase_is_started) {
+		erase_is_started=FALSE;
+		erase_address+=_flash_sector_size;
+		if(erase_address>=erase_end) return FALSE;
 	}
+	CMD_WREN();
+	Flash_cs_low();
+	send_byte( FLASH_CMD_SE );
+	send_flash_address( erase_address );
+	Flash_cs_high();
+	erase_is_started=TRUE;
+	return TRUE;
+}
+
+/**
+ * \brief Wait until the erase in background is done
+ */
+void flash_erase_wait(void) {
+	while(flash_erase_poll());
 }
 
 /**
@@ -481,21 +647,21 @@ void get_flash_image_info(image_information_t * image_info) {
 		image_info->new_image_address=_image144_address(new_address_offset);
 		//erase next space
 		if(empty_address_offset!=_image_state_is_empty)
-			erase_image(_image144_address(empty_address_offset),image_info->EPD_size);
+			erase_image_background(_image144_address(empty_address_offset),image_info->EPD_size);
 		break;
 	case EPD_200:
 		image_info->previous_image_address=_image200_address(previous_address_offset);
 		image_info->new_image_address=_image200_address(new_address_offset);
 		//erase next space
 		if(empty_address_offset!=_image_state_is_empty)
-			erase_image(_image200_address(empty_address_offset),image_info->EPD_size);
+			erase_image_background(_image200_address(empty_address_offset),image_info->EPD_size);
 		break;
 	case EPD_270:
 		image_info->previous_image_address=_image270_address(previous_address_offset);
 		image_info->new_image_address=_image270_address(new_address_offset);
 		//erase next space
 		if(empty_address_offset!=_image_state_is_empty)
-			erase_image(_image270_address(empty_address_offset),image_info->EPD_size);
+			erase_image_background(_image270_address(empty_address_offset),image_info->EPD_size);
 		break;
 	}
 	if(image_info->extend_address.last_address!=_NULL_address)
@@ -629,3 +795,45 @@ void read_slideshow_parameters(slideshow_information_t * slideshow_info) {
 	addr-=(sizeof(slideshow_information_t)*2);
 	flash_cmd_read(addr,(uint8_t *)slideshow_info,sizeof(slideshow_information_t));
 }
+
+/**
+ * \brief Read temperature model of EPD size from defined Flash sector
+ *
+ * \note It is called by COG driver to load temperature model, the SPI is
+ *       attached already.
+ *
+ * \param EPD_type_index The defined EPD size
+ * \param model The structure of temperature model
+ * \return TRUE if the model is stored and its CRC is correct
+ */
+uint8_t read_temperature_model(uint8_t EPD_type_index,struct EPD_temperature_model_t *model) {
+	uint8_t crc[2];
+	long addr=_temperature_model_address(EPD_type_index);
+	flash_cmd_read(addr,(uint8_t *)model,sizeof(struct EPD_temperature_model_t));
+	flash_cmd_read(addr+sizeof(struct EPD_temperature_model_t),crc,2);
+	return (crc16_block(crc16_block(CRC16_INITIAL_VALUE,(uint8_t *)model,
+	                                sizeof(struct EPD_temperature_model_t)),crc,2)==0);
+}
+
+/**
+ * \brief Update temperature model of EPD size
+ *
+ * \param EPD_type_index The defined EPD size
+ * \param model The structure of temperature model, the sector is only erased
+ *        if the model is not valid
+ * \return TRUE if the model is written
+ */
+uint8_t write_temperature_model(uint8_t EPD_type_index,struct EPD_temperature_model_t *model) {
+	uint8_t crc[2];
+	uint16_t tmp;
+	long addr=_temperature_model_address(EPD_type_index);
+	epd_spi_attach();
+	CMD_SE(addr);
+	if(!EPD_temperature_model_is_valid(model)) return FALSE;
+	tmp=crc16_block(CRC16_INITIAL_VALUE,(uint8_t *)model,sizeof(struct EPD_temperature_model_t));
+	crc[0]=(uint8_t)(tmp>>8);
+	crc[1]=(uint8_t)tmp;
+	write_flash(addr,(uint8_t *)model,sizeof(struct EPD_temperature_model_t));
+	write_flash(addr+sizeof(struct EPD_temperature_model_t),crc,2);
+	return TRUE;
+}
@@ -139,6 +139,10 @@
 #define _parameters_address					0xFF000
 #define _parameters_address_max				0xFFFF0
 
+/** The temperature model of each EPD size is stored at one flash sector from 0xFC000,
+ *  followed by CRC-16 of model (high byte first) */
+#define _temperature_model_address(x)		(0xFC000+((long)x<<12))
+
 /******************************************************************************/
 #define _image_state_in_use    0xAF
 #define _image_state_is_empty  0xFF
@@ -184,6 +188,11 @@ typedef struct {
 #define FLASH_CMD_BE 0xD8        //BE (Block Erase)
 #define FLASH_CMD_CE 0x60        //CE (Chip Erase) hex code: 60 or C7
 
+/** Suspend commands, the Flash without suspend feature ignores them */
+#define FLASH_CMD_PES    0xB0    //PGM/ERS Suspend
+#define FLASH_CMD_PER    0x30    //PGM/ERS Resume
+#define FLASH_CMD_RDSCUR 0x2B    //RDSCUR (Read Security Register)
+
 /** Mode setting commands */
 #define FLASH_CMD_DP  0xB9       //DP (Deep Power Down)
 #define FLASH_CMD_RDP 0xAB       //RDP (Release form Deep Power Down)
@@ -193,6 +202,14 @@ typedef struct {
 #define FLASH_LDSO_MASK 0x02
 #define FLASH_QE_MASK   0x40
 
+/** security register */
+#define FLASH_ESB_MASK  0x08     //the erase is suspended
+
+/** The erase suspend is regarded as not supported if WIP doesn't clear in this uSec */
+#define FLASH_SUSPEND_TIMEOUT_US  1000
+/** The erase runs at least this uSec after resume before it is suspended again */
+#define FLASH_RESUME_SUSPEND_US   100
+
 uint8_t is_flash_existed(void);
 
 void Flash_cs_high(void);
@@ -207,6 +224,10 @@ void read_flash(long Address,uint8_t *target_address, uint8_t byte_length);
 void write_flash(long Address,uint8_t *source_address, uint8_t byte_length);
 
 void erase_image(long address,uint8_t ptype);
+void erase_image_background(long address,uint8_t EPD_size);
+uint8_t is_image_slot_address(long address,uint8_t EPD_size);
+uint8_t flash_erase_poll(void);
+void flash_erase_wait(void);
 void get_flash_image_info(image_information_t * ImageInfo);
 long get_flash_mark_image_info(uint8_t PlaneType);
 long get_custom_image_address(uint8_t  PlaneType,uint8_t ImageIdx,uint8_t IsClear);
@@ -216,5 +237,7 @@ void Readtest(void);
 void write_ascii(long CanvasAddress,long MarkAddress,uint16_t LocationX,uint16_t LocationY,char *Text);
 void read_slideshow_parameters(slideshow_information_t * SlideshowInfo);
 void write_slideshow_parameters(slideshow_information_t * SlideshowInfo);
+uint8_t read_temperature_model(uint8_t EPD_type_index,struct EPD_temperature_model_t *model);
+uint8_t write_temperature_model(uint8_t EPD_type_index,struct EPD_temperature_model_t *model);
 
 #endif /* MEM_FLASH_H_ */
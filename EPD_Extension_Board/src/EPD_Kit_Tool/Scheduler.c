@@ -0,0 +1,157 @@
+/**
+* \file
+*
+* \brief The run-to-completion task scheduler with event flags and low power idle
+*
+* Copyright (c) 2012-2014 Pervasive Displays Inc. All rights reserved.
+*
+*  Authors: Pervasive Displays Inc.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*  1. Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*  2. Redistributions in binary form must reproduce the above copyright
+*     notice, this list of conditions and the following disclaimer in
+*     the documentation and/or other materials provided with the
+*     distribution.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "EPD_Kit_Tool_Process.h"
+
+static const scheduler_task_t *scheduler_tasks;
+static uint8_t scheduler_task_count;
+/** The posted event flags, set by interrupts and tasks, cleared by dispatch */
+static volatile uint8_t scheduler_events;
+#if MCU_CLOCK_SCALING
+/** The low 16 bits of system mSec as the last event but EVENT_TIMER was
+ *  dispatched, the idle time is checked against SCHEDULER_IDLE_CLOCK_MS only */
+static uint16_t scheduler_busy_ms;
+#endif
+
+/**
+ * \brief Initialize the task table of scheduler
+ *
+ * \param tasks The task table, the tasks run in the order of table
+ * \param count The number of tasks
+ */
+void scheduler_init(const scheduler_task_t *tasks,uint8_t count) {
+	scheduler_tasks=tasks;
+	scheduler_task_count=count;
+	scheduler_events=0;
+}
+
+/**
+ * \brief Post event flags to make tasks runnable
+ *
+ * \note It can be called by interrupt. Setting bits of a byte is a single
+ *       instruction on MSP430, so it needs no lock.
+ *
+ * \param events The event flags
+ */
+void scheduler_post(uint8_t events) {
+	scheduler_events|=events;
+}
+
+/**
+ * \brief Run the tasks of posted events once, or sleep until an event is posted
+ *
+ * \note
+ * - A task posts its own event if it has more work, so the CPU stays awake
+ *   only while there is something to do.
+ * - The CPU sleeps in LPM0 since Timer0_A and UART are clocked by SMCLK.
+ *   The interrupts which post events exit the low power mode.
+ * - The events are checked with interrupt disabled, and GIE is set with the
+ *   sleep in one instruction, so an event can't be posted in between. They
+ *   are checked again after the clock switch, which may pass the byte
+ *   waiting in UART to its handler and post EVENT_UART_RX.
+ * - The CPU never sleeps in LPM3. The system time base, delays, UART and
+ *   PWM run on SMCLK, which LPM3 stops; the MCU clock is lowered instead.
+ * - The MCU sleeps at MCU_CLOCK_WAIT after idle for SCHEDULER_IDLE_CLOCK_MS,
+ *   and runs at MCU_CLOCK_RUN again as an event but EVENT_TIMER is posted.
+ *   The tasks of EVENT_TIMER may run at either clock. The work which needs
+ *   full speed switches to MCU_CLOCK_RUN by itself, e.g. the EPD updates
+ *   of slideshow and the power off of COG as power session closes. The
+ *   erase in background only polls the status of Flash and starts the next
+ *   sector, it is allowed at MCU_CLOCK_WAIT since SPI and delays follow the
+ *   clock and the Flash has no timing requirement on them.
+ */
+void scheduler_dispatch(void) {
+	uint8_t i,events;
+	__disable_interrupt();
+	events=scheduler_events;
+	if(events==0) {
+#if MCU_CLOCK_SCALING
+		if((uint16_t)((uint16_t)get_system_ms()-scheduler_busy_ms)>=SCHEDULER_IDLE_CLOCK_MS)
+			set_MCU_clock(MCU_CLOCK_WAIT);
+		if(scheduler_events!=0) {
+			__enable_interrupt();
+			return;
+		}
+#endif
+		__bis_SR_register(LPM0_bits + GIE);
+		return;
+	}
+	scheduler_events=0;
+	__enable_interrupt();
+#if MCU_CLOCK_SCALING
+	if(events & ~EVENT_TIMER) {
+		scheduler_busy_ms=(uint16_t)get_system_ms();
+		set_MCU_clock(MCU_CLOCK_RUN);
+	}
+#endif
+	for(i=0; i<scheduler_task_count; i++) {
+		if(scheduler_tasks[i].events & events) scheduler_tasks[i].handler();
+	}
+}
+
+/**
+ * \brief Start a timer of long period job
+ *
+ * \param timer The timer
+ * \param period The period in mSec, 0 stops the timer
+ */
+void scheduler_timer_start(scheduler_timer_t *timer,uint32_t period) {
+	timer->start=get_system_ms();
+	timer->period=period;
+}
+
+/**
+ * \brief Stop a timer, it will never be due
+ */
+void scheduler_timer_stop(scheduler_timer_t *timer) {
+	timer->period=0;
+}
+
+/**
+ * \brief Make a running timer due now
+ */
+void scheduler_timer_expire(scheduler_timer_t *timer) {
+	timer->start=get_system_ms()-timer->period;
+}
+
+/**
+ * \brief Check if the period of timer has elapsed
+ *
+ * \note The timer keeps due until it is started again.
+ *
+ * \return 1=due, 0=not due or stopped
+ */
+uint8_t scheduler_timer_is_due(const scheduler_timer_t *timer) {
+	if(timer->period==0) return FALSE;
+	return (get_system_ms()-timer->start)>=timer->period;
+}
@@ -0,0 +1,74 @@
+/**
+* \file
+*
+* \brief The run-to-completion task scheduler with event flags and low power idle
+*
+* Copyright (c) 2012-2014 Pervasive Displays Inc. All rights reserved.
+*
+*  Authors: Pervasive Displays Inc.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*  1. Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*  2. Redistributions in binary form must reproduce the above copyright
+*     notice, this list of conditions and the following disclaimer in
+*     the documentation and/or other materials provided with the
+*     distribution.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include <Pervasive_Displays_small_EPD.h>
+
+/**
+ * \brief The event flags which make tasks runnable */
+#define EVENT_UART_RX    (uint8_t)(0x01) /**< system packet or bulk data has been received */
+#define EVENT_TIMER      (uint8_t)(0x02) /**< system time base overflows (32.768mSec) */
+#define EVENT_SPI_FLASH  (uint8_t)(0x04) /**< the work on SPI (EPD update or Flash read) continues */
+
+/** The MCU sleeps at MCU_CLOCK_WAIT if no event but EVENT_TIMER has been
+ *  posted for this mSec */
+#define SCHEDULER_IDLE_CLOCK_MS 100
+
+typedef void (*scheduler_task_handler)(void);
+
+/**
+ * \brief The task runs when any of its events has been posted */
+typedef struct {
+	uint8_t events;                 /**< the event flags of task */
+	scheduler_task_handler handler; /**< the task function which runs to completion */
+} scheduler_task_t;
+
+/**
+ * \brief The timer of long period job, checked by a task of EVENT_TIMER
+ * \note It counts the monotonic mSec of system, the period can be up to 24 days. */
+typedef struct {
+	uint32_t start;  /**< the system mSec as the timer starts */
+	uint32_t period; /**< the period in mSec, 0=stopped */
+} scheduler_timer_t;
+
+void scheduler_init(const scheduler_task_t *tasks,uint8_t count);
+void scheduler_post(uint8_t events);
+void scheduler_dispatch(void);
+void scheduler_timer_start(scheduler_timer_t *timer,uint32_t period);
+void scheduler_timer_stop(scheduler_timer_t *timer);
+void scheduler_timer_expire(scheduler_timer_t *timer);
+uint8_t scheduler_timer_is_due(const scheduler_timer_t *timer);
+
+#endif /* SCHEDULER_H_ */
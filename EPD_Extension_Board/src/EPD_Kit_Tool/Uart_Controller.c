@@ -37,146 +37,374 @@
 
 
 static receive_packets_event _receive_packets_event;
-static serial_buffer_t data_Rx_buffer;
 /** declare the number of system packet used interchangeably, default=2 */
 static system_packets_t system_packets[__System_Buffer_Size];
-static uint8_t system_packet_count;
-static uint8_t system_packet_get_index, system_packet_put_index;
+/** The system packet buffer indexes run freely. The put index is only written
+ *  by RX interrupt and the get index is only written by main loop. */
+static volatile uint8_t system_packet_get_index, system_packet_put_index;
+
+/** The state of receiving a system packet byte by byte */
+static uint8_t rx_state;
+static uint8_t rx_index, rx_length, rx_data_end;
+static uint16_t rx_crc;
+static uint8_t *rx_packet;
+
+/** The state of bulk transfer. The image bytes are stored into a byte ring
+ *  which uses the memory of system packet buffer. */
+#define bulk_buffer ((uint8_t *)system_packets)
+static receive_bulk_event _receive_bulk_event;
+static volatile uint8_t bulk_get_index, bulk_put_index;
+static uint16_t bulk_remaining;
+static uint8_t bulk_pending, bulk_result_is_sent;
+/** Set by RX interrupt as the ring overflows or by main loop as the handler fails,
+ *  then the rest of bytes are counted but not stored */
+static volatile uint8_t bulk_error;
+static uint8_t bulk_header, bulk_command;
+static uint16_t bulk_kit_id;
+/** The bulk_remaining and the low 16 bits of mSec when the bulk transfer was
+ *  seen progressing */
+static uint16_t bulk_progress_remaining;
+static uint16_t bulk_progress_ms;
+
+/** The result packets are captured instead of transmitting during batch commands */
+static uint8_t result_capture, captured_result;
+
+static void transmit_system_packets(system_packets_t *packet);
 
 /**
 * \brief Clear system packet buffer  */
 static void clear_system_buffer(void) {
-	system_packet_count=0;
 	system_packet_get_index=0;
 	system_packet_put_index=0;
+	rx_state=Rx_State_Header;
 }
 
 /**
-* \brief Input data to system packet buffer
-*
-* \param system_packet The received new system packet
-* \param length The length of received system packet
-*
-* \return There is buffer to be used or not
+* \brief Return the number of system packet buffer has been used
 */
-static uint8_t put_system_buffer(uint8_t *system_packet,uint8_t length) {
-	system_packet_put_index &=__System_Buffer_Mark;
-	memcpy ((void *)(&system_packets[system_packet_put_index]), system_packet,length-1);
-	if(system_packet_count < __System_Buffer_Size) {
-		system_packet_count++;
-		system_packet_put_index++;
-		system_packet_put_index &=__System_Buffer_Mark;
-		return TRUE;
-	}
-	return FALSE;
+static uint8_t number_of_system_buffer(void) {
+	return (uint8_t)(system_packet_put_index-system_packet_get_index);
 }
 
 /**
-* \brief Get data from system packet buffer
-*
-* \return The system packet buffer index
+* \brief Release the system packet buffer after it has been handled
 */
-static system_packets_t * get_system_buffer(void) {
-	system_packets_t *value;
-	if(system_packet_count >0) {
-		value = &system_packets[system_packet_get_index];
-		system_packet_count--;
-		system_packet_get_index++;
-		system_packet_get_index &=__System_Buffer_Mark;
+static void release_system_buffer(void) {
+	if(number_of_system_buffer() >0) system_packet_get_index++;
+}
+
+/**
+ * \brief Check there are received packets or bulk data for main loop
+ *
+ * \return TRUE if poll_system_packet_buffer has work to do
+ */
+static uint8_t is_receive_pending(void) {
+	if(rx_state>=Rx_State_Bulk) {
+		return (bulk_put_index!=bulk_get_index || rx_state==Rx_State_Bulk_Done ||
+		        (bulk_error && !bulk_result_is_sent));
 	}
-	return value;
+	return (number_of_system_buffer()>0);
 }
 
 /**
-* \brief Return the number of system packet buffer has been used
-*/
-static uint8_t number_of_system_buffer(void) {
-	return system_packet_count;
-}
-
-/**
- * \brief Check the format of system packets
- */
-static void system_packets_format_check(void) {
-	uint8_t i,len,crc;
-	uint8_t  tmp_data[__System_Packet_Length_Max];
-	if(data_Rx_buffer.count>=__System_Packet_Length_Min) {
-		/** the system packet header of extension board with EPD Kit Tool is 0xB3 */
-		if(data_Rx_buffer.buffer[data_Rx_buffer.get_index]==__System_Packet_Header) {
-			len=data_Rx_buffer.buffer[data_Rx_buffer.get_index+Sys_Packets_Length];
-			if(len<__System_Packet_Length_Min || len>__System_Packet_Length_Max) {
-				data_Rx_buffer.count--;
-				data_Rx_buffer.get_index++;
-			} else if(len<=data_Rx_buffer.count) {
-				crc=0;
-				for(i=0; i<len; i++) {
-					/** Generate CRC byte for checking later */
-					crc^=data_Rx_buffer.buffer[(uint8_t)(i+data_Rx_buffer.get_index)
-					                           & __System_Packet_Length_Mark];
-					tmp_data[i]=data_Rx_buffer.buffer[(uint8_t)(i+data_Rx_buffer.get_index)
-					                                  & __System_Packet_Length_Mark];
-				}
-				if(crc==0) {
-					put_system_buffer((uint8_t *)tmp_data,len);
-					data_Rx_buffer.count-=len;
-					data_Rx_buffer.get_index+=len;
-				} else {
-					data_Rx_buffer.count--;
-					data_Rx_buffer.get_index++;
-				}
+ * \brief Parse one received byte into system packet buffer
+ *
+ * \note
+ * - It is called by RX interrupt for every byte and runs in constant time.
+ * - The byte is written directly into the free system packet buffer and the
+ *   CRC is updated incrementally. The packet is put into the buffer only
+ *   when the CRC is correct, otherwise it waits for next header.
+ * - The header selects protocol version 1 (XOR byte) or 2 (CRC-16).
+ *
+ * \param data The received byte
+ */
+static void system_packet_parse(uint8_t data) {
+	switch(rx_state) {
+	case Rx_State_Bulk:
+		/** The last two bytes are CRC-16 of image bytes and not stored */
+		if(bulk_remaining>2 && !bulk_error) {
+			if((uint8_t)(bulk_put_index-bulk_get_index)>=__Bulk_Buffer_Size) {
+				LINK_STATISTICS_COUNT(rx_overflow);
+				bulk_error=1;
+			} else {
+				bulk_buffer[bulk_put_index & __Bulk_Buffer_Mark]=data;
+				bulk_put_index++;
 			}
-		} else {
-			data_Rx_buffer.count--;
-			data_Rx_buffer.get_index++;
 		}
-		data_Rx_buffer.get_index &= __System_Packet_Length_Mark;
+		rx_crc=crc16_update(rx_crc,data);
+		if((--bulk_remaining)==0) rx_state=Rx_State_Bulk_Done;
+		return;
+	case Rx_State_Bulk_Done:
+		/** Wait for main loop to write the rest of data and return result */
+		return;
+	case Rx_State_Length:
+		if(data>=(__System_Packet_Head_Size+__System_Packet_Check_Size(rx_packet[Sys_Packets_Header]))
+		   && data<=__System_Packet_Length_Max) {
+			rx_packet[Sys_Packets_Length]=data;
+			rx_length=data;
+			rx_data_end=data-__System_Packet_Check_Size(rx_packet[Sys_Packets_Header]);
+			rx_index=Sys_Packets_Length+1;
+			rx_state=Rx_State_Body;
+			break;
+		}
+		/** Invalid length, this byte may be the header of next packet */
+		rx_state=Rx_State_Header;
+	case Rx_State_Header:
+		/** the system packet header of extension board with EPD Kit Tool is 0xB3 or 0xB4 */
+		if(data!=__System_Packet_Header && data!=__System_Packet_Header_V2) break;
+		/** Drop the packet if there is no free buffer */
+		if(number_of_system_buffer()>=__System_Buffer_Size) {
+			LINK_STATISTICS_COUNT(rx_overflow);
+			break;
+		}
+		rx_packet=(uint8_t *)&system_packets[system_packet_put_index & __System_Buffer_Mark];
+		rx_packet[Sys_Packets_Header]=data;
+		rx_crc=(data==__System_Packet_Header_V2) ? crc16_update(CRC16_INITIAL_VALUE,data) : data;
+		rx_state=Rx_State_Length;
+		return;
+	case Rx_State_Body:
+		/** The CRC bytes are at the end of packets excluding in system_packets_t */
+		if(rx_index<rx_data_end) rx_packet[rx_index]=data;
+		rx_index++;
+		break;
+	}
+	if(rx_state!=Rx_State_Body) return;
+	if(rx_packet[Sys_Packets_Header]==__System_Packet_Header_V2) rx_crc=crc16_update(rx_crc,data);
+	else rx_crc^=data;
+	if(rx_index==rx_length) {
+		if(rx_crc==0) system_packet_put_index++;
+		else LINK_STATISTICS_COUNT(rx_crc_error);
+		rx_state=Rx_State_Header;
 	}
 }
 
 /**
- * \brief Save receiving data to buffer
+ * \brief Save receiving data to system packet buffer
  *
  * \param data The address pointer of receiving system packet
  * \param len The data length of receiving system packet
  */
 static void data_receive_handle(uint8_t *data,uint8_t len) {
 	while(len--) {
-		data_Rx_buffer.buffer[data_Rx_buffer.put_index] = *data++;
-		data_Rx_buffer.put_index++;
-		data_Rx_buffer.put_index &=(SERIAL_RX_MAX_LEN-1);
-		data_Rx_buffer.count++;
-		data_Rx_buffer.count &=(SERIAL_RX_MAX_LEN-1);
+		system_packet_parse(*data++);
 	}
-	system_packets_format_check();
+	if(is_receive_pending()) scheduler_post(EVENT_UART_RX);
+}
+
+/**
+ * \brief Return the result packet of bulk transfer
+ *
+ * \note The packet is built at the start of ring, the RX interrupt doesn't
+ *       store bytes any more as the transfer is done or fails.
+ *
+ * \param result TRUE if all bytes are received and handled
+ */
+static void return_bulk_result(uint8_t result) {
+	system_packets_t *packet=&system_packets[0];
+	packet->packet_header=bulk_header;
+	packet->packet_length=__System_Packet_Head_Size+__System_Packet_Check_Size(bulk_header)+1;
+	packet->kit_id=bulk_kit_id;
+	packet->command_type=bulk_command;
+	packet->data[0]=result;
+	transmit_system_packets(packet);
+	bulk_result_is_sent=1;
+}
+
+/**
+ * \brief Pass the received bulk data to the handler and return the result
+ *        packet when all bytes have been received
+ *
+ * \note The FALSE result returns as soon as the ring overflows or the handler
+ *       fails, so the host can stop sending. The rest of bytes are dropped
+ *       until the end of transfer or the timeout of bulk transfer.
+ */
+static void poll_bulk_buffer(void) {
+	uint8_t len,pos,done;
+	/** Read the state first, all bytes are in the ring if it is done */
+	done=(rx_state==Rx_State_Bulk_Done);
+	if(bulk_error) {
+		bulk_get_index=bulk_put_index;
+		if(!bulk_result_is_sent) return_bulk_result(FALSE);
+		if(done) clear_system_buffer();
+		return;
+	}
+	len=(uint8_t)(bulk_put_index-bulk_get_index);
+	if(len>0) {
+		/** Hand over the contiguous part of the ring without copy */
+		pos=bulk_get_index & __Bulk_Buffer_Mark;
+		if(len>(__Bulk_Buffer_Size-pos)) len=__Bulk_Buffer_Size-pos;
+		if(_receive_bulk_event!=NULL && !_receive_bulk_event(&bulk_buffer[pos],len)) bulk_error=1;
+		bulk_get_index+=len;
+	} else if(done) {
+		return_bulk_result((rx_crc==0) ? TRUE : FALSE);
+		clear_system_buffer();
+	}
+}
+
+/**
+ * \brief Get the system packet which will be handled next without releasing it
+ *
+ * \return The pointer of system packet, or NULL if there is no packet
+ */
+system_packets_t *peek_system_packet(void) {
+	if(rx_state>=Rx_State_Bulk || number_of_system_buffer()==0) return NULL;
+	return &system_packets[system_packet_get_index & __System_Buffer_Mark];
 }
 
 /**
  * \brief Polling data from system packet buffer
+ *
+ * \note The buffer is released after the packet is handled since the handler
+ *       returns the result by the same buffer.
  */
 void poll_system_packet_buffer(void) {
-	if(number_of_system_buffer()>0) {
+	if(rx_state>=Rx_State_Bulk) {
+		poll_bulk_buffer();
+	} else if(number_of_system_buffer()>0) {
 		if(_receive_packets_event!=NULL) {
-			_receive_packets_event(get_system_buffer());
-		} else get_system_buffer();
+			_receive_packets_event(&system_packets[system_packet_get_index & __System_Buffer_Mark]);
+		}
+		release_system_buffer();
+		/** Switch to bulk transfer after the command packet is released since
+		 *  the bulk data uses the same memory */
+		if(bulk_pending) {
+			bulk_pending=0;
+			bulk_get_index=0;
+			bulk_put_index=0;
+			bulk_error=0;
+			bulk_result_is_sent=0;
+			rx_crc=CRC16_INITIAL_VALUE;
+			bulk_progress_remaining=bulk_remaining;
+			bulk_progress_ms=(uint16_t)get_system_ms();
+			rx_state=Rx_State_Bulk;
+		}
 	}
+	/** Run again for the rest of packets or bulk data */
+	if(is_receive_pending()) scheduler_post(EVENT_UART_RX);
 }
 
 /**
- * \brief Return system packet
+ * \brief Append the check bytes and transmit system packet
  *
  * \param packet The address pointer of system packet that will return
  */
-void return_system_packets(system_packets_t *packet) {
+static void transmit_system_packets(system_packets_t *packet) {
 	uint8_t i;
 	uint8_t *buf;
+	uint16_t crc;
+	if(result_capture) return;
 	buf=(uint8_t *)packet;
-	buf[packet->packet_length-1]=0;
-	for(i=0; i<packet->packet_length-1; i++) {
-		buf[packet->packet_length-1]^=buf[i];
+	if(packet->packet_header==__System_Packet_Header_V2) {
+		crc=crc16_block(CRC16_INITIAL_VALUE,buf,packet->packet_length-2);
+		buf[packet->packet_length-2]=(uint8_t)(crc>>8);
+		buf[packet->packet_length-1]=(uint8_t)crc;
+	} else {
+		buf[packet->packet_length-1]=0;
+		for(i=0; i<packet->packet_length-1; i++) {
+			buf[packet->packet_length-1]^=buf[i];
+		}
 	}
 	data_transmit(buf,packet->packet_length);
 }
 
+/**
+ * \brief Get the length of data[] of system packet
+ *
+ * \param packet The address pointer of system packet
+ */
+uint8_t get_packet_data_length(system_packets_t *packet) {
+	return packet->packet_length-__System_Packet_Head_Size-
+	       __System_Packet_Check_Size(packet->packet_header);
+}
+
+/**
+ * \brief Receive the following bytes as raw data instead of system packets
+ *
+ * \note
+ * - The bulk transfer starts after the command packet has been handled. The
+ *   host sends the data bytes and CRC-16 of data bytes (high byte first)
+ *   without packet framing after it received the result of command.
+ * - The data bytes are passed to OnRxBulkEvent by main loop in pieces.
+ * - The result packet returns with the header, kit ID and command type of
+ *   command packet after all bytes are received. The FALSE result returns
+ *   at once if the ring overflows since main loop is held, or
+ *   OnRxBulkEvent returns FALSE.
+ * - The result is FALSE if the host stops sending for __Bulk_Timeout_ms,
+ *   see poll_bulk_timeout.
+ *
+ * \param packet The address pointer of command packet
+ * \param length The number of data bytes, excluding CRC
+ * \param OnRxBulkEvent The handler of received data
+ * \return TRUE if the bulk transfer is ready to start
+ */
+uint8_t start_bulk_receive(system_packets_t *packet,uint16_t length,
+                           receive_bulk_event OnRxBulkEvent) {
+	/** The buffer must be free except the command packet */
+	if(length==0 || length>0xFFFD || number_of_system_buffer()!=1) return FALSE;
+	bulk_header=packet->packet_header;
+	bulk_kit_id=packet->kit_id;
+	bulk_command=packet->command_type;
+	bulk_remaining=length+2;
+	_receive_bulk_event=OnRxBulkEvent;
+	bulk_pending=1;
+	return TRUE;
+}
+
+/**
+ * \brief Check the bulk transfer is in progress
+ *
+ * \return TRUE if the received bytes are bulk data, not system packets
+ */
+uint8_t is_bulk_receiving(void) {
+	return (rx_state>=Rx_State_Bulk || bulk_pending);
+}
+
+/**
+ * \brief Abort the bulk transfer if no byte is received for __Bulk_Timeout_ms
+ *
+ * \note
+ * - It is called periodically by main loop, e.g. by timer event. The progress
+ *   is sampled by the rest of bytes, so the RX interrupt doesn't read time.
+ * - The received bytes not handled yet are dropped and the result packet
+ *   returns FALSE unless it has returned as the transfer failed, then the
+ *   receiver waits for the header of next packet.
+ *
+ * \return TRUE if the bulk transfer has been aborted by this call
+ */
+uint8_t poll_bulk_timeout(void) {
+	uint16_t remaining;
+	unsigned short state;
+	if(rx_state!=Rx_State_Bulk) return FALSE;
+	remaining=bulk_remaining;
+	if(remaining!=bulk_progress_remaining) {
+		bulk_progress_remaining=remaining;
+		bulk_progress_ms=(uint16_t)get_system_ms();
+		return FALSE;
+	}
+	if((uint16_t)((uint16_t)get_system_ms()-bulk_progress_ms)<__Bulk_Timeout_ms) return FALSE;
+	state=__get_interrupt_state();
+	__disable_interrupt();
+	if(rx_state!=Rx_State_Bulk) {
+		/** The last byte came just now */
+		__set_interrupt_state(state);
+		return FALSE;
+	}
+	rx_state=Rx_State_Bulk_Done;
+	__set_interrupt_state(state);
+	bulk_error=1;
+	poll_bulk_buffer();
+	return TRUE;
+}
+
+/**
+ * \brief Return system packet
+ *
+ * \param packet The address pointer of system packet that will return
+ */
+void return_system_packets(system_packets_t *packet) {
+	transmit_system_packets(packet);
+}
+
 /**
  * \brief Return system packet result
  *
@@ -185,16 +413,10 @@ void return_system_packets(system_packets_t *packet) {
  * \param len The length of return data packet
  */
 void return_packets(system_packets_t *packet,uint8_t *data,uint8_t len) {
-	uint8_t i;
-	uint8_t *buf;
-	packet->packet_length=6+len;
+	packet->packet_length=__System_Packet_Head_Size+
+	                      __System_Packet_Check_Size(packet->packet_header)+len;
 	memcpy((uint8_t *)&packet->data[0],data,len);
-	buf=(uint8_t *)packet;
-	buf[packet->packet_length-1]=0;
-	for(i=0; i<packet->packet_length-1; i++) {
-		buf[packet->packet_length-1]^=buf[i];
-	}
-	data_transmit(buf,packet->packet_length);
+	transmit_system_packets(packet);
 }
 
 /**
@@ -204,18 +426,40 @@ void return_packets(system_packets_t *packet,uint8_t *data,uint8_t len) {
  * \param result Success or failure
  */
 void return_system_packet_result(system_packets_t *packet,uint8_t result) {
+	if(result_capture) captured_result=result;
 	return_packets(packet,(uint8_t *)&result,1);
 }
 
+/**
+ * \brief Capture the result of commands instead of returning packets
+ *
+ * \note The commands of batch are executed one by one and only one result
+ *       returns for all of them.
+ *
+ * \param enable TRUE to start capturing, FALSE to return packets again
+ */
+void capture_system_packet_result(uint8_t enable) {
+	result_capture=enable;
+	captured_result=TRUE;
+}
+
+/**
+ * \brief Get the result of last command since last call during capturing
+ *
+ * \return The result, TRUE if the command didn't return result
+ */
+uint8_t get_captured_result(void) {
+	uint8_t result=captured_result;
+	captured_result=TRUE;
+	return result;
+}
+
 /**
 * \brief Initialize the UART data buffer and trigger receiving (Rx) packets
 *
 * \param receive_packets_event For trigger Rx packet
 */
 void data_controller_init(receive_packets_event OnRxPacketEvent) {
-	data_Rx_buffer.count=0;
-	data_Rx_buffer.get_index=0;
-	data_Rx_buffer.put_index=0;
 	clear_system_buffer();
 	data_interface_init(data_receive_handle);
 	_receive_packets_event=OnRxPacketEvent;
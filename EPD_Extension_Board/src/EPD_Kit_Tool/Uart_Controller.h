@@ -37,22 +37,66 @@
 
 /** The definition of system packet ******************************************/
 #define   __System_Buffer_Size BUFFER_SIZE /*!< number of system packet used interchangeably, default=1 */
-#define   __System_Buffer_Mark __System_Buffer_Size-1
+#define   __System_Buffer_Mark (__System_Buffer_Size-1)
+
+#if (__System_Buffer_Size & __System_Buffer_Mark) || __System_Buffer_Size>128
+#error "BUFFER_SIZE must be power of 2 and not larger than 128"
+#endif
 
 #define  __System_Packet_Header      0xB3         /*!< 0xB3 header is for PDi Extension Kit */
+#define  __System_Packet_Header_V2   0xB4         /*!< Protocol version 2 header, CRC-16 instead of XOR byte */
 #define  __System_Packet_Length_Min  6            /*!< Minimum system packet length without data[] */
 #define  __System_Packet_Length_Max  PAYLOAD_SIZE /*!< Maximum system packet length */
 #define  __System_Packet_Length_Mark (__System_Packet_Length_Max-1) /*!< System packet maximum position */
+#define  __System_Packet_Head_Size   5            /*!< Header, length, kit ID and command type */
+
+#if UART_TX_BUFFER_SIZE<__System_Packet_Length_Max
+#error "UART_TX_BUFFER_SIZE must hold a system packet of maximum length"
+#endif
+
+/** The number of check bytes at the end of packet by protocol version */
+#define  __System_Packet_Check_Size(header) (((header)==__System_Packet_Header_V2) ? 2 : 1)
+
+/** The highest protocol version is supported
+ * \note
+ * - Version 1: header 0xB3, XOR of all bytes as the last byte
+ * - Version 2: header 0xB4, CRC-16/CCITT of all bytes as the last two bytes (high byte first)
+ * - The result packet uses the same version as the command packet */
+#define  __Protocol_Version_Max      2
+
+/** The byte ring of bulk transfer uses the memory of system packet buffer
+ *  which is free during bulk transfer, must be power of 2 */
+#define  __Bulk_Buffer_Size          64
+#define  __Bulk_Buffer_Mark          (__Bulk_Buffer_Size-1)
+
+#if (__System_Buffer_Size*(__System_Packet_Head_Size+__System_Packet_Length_Max))<__Bulk_Buffer_Size
+#error "The system packet buffer is too small for bulk transfer"
+#endif
+
+/** The bulk transfer is aborted if no byte is received for this mSec */
+#define  __Bulk_Timeout_ms           500
 
 /** The definition of command type *******************************************/
 #define  __Kit_ID                  0x10
 #define  __Temperature             0x11
 #define  __EPD_Board               0x12
+#define  __Link_Statistics         0x13
+#define  __Protocol_Version        0x14
+#define  __Update_Event_Mode       0x15
+#define  __Temperature_Model       0x16
+#define  __Set_Temperature_Model   0x17
+#define  __Clock_Statistics        0x18
+#define  __SPI_Benchmark           0x19
+#define  __SPI_Bus_Statistics      0x1A
 #define  __Firmware_Version        0x1F
 
 #define  __Clear_Image             0x20
 #define  __Load_Image              0x21
 #define  __Show_Image              0x22
+#define  __Bulk_Load_Image         0x23
+#define  __Load_Encoded_Image      0x24
+#define  __Bulk_Load_Encoded_Image 0x25
+#define  __Set_Reference_Image     0x26
 
 #define  __Clear_ASCII             0x30
 #define  __Load_ASCII              0x31
@@ -72,6 +116,17 @@
 #define  __Reload_Current_Image    0x60
 #define  __Clear_All_Flash         0x61
 #define  __Trigger_LED             0x62
+#define  __Read_Flash              0x63
+#define  __Read_Image              0x64
+#define  __Get_Image_CRC           0x65
+
+#define  __Batch_Commands          0x70
+
+/** The unsolicited event packet from board */
+#define  __Update_Event            0x80
+
+/** The result of a waiting show request which is replaced by a newer one */
+#define  __Result_Superseded       0x02
 
 /******************************************************************/
 enum 
@@ -82,6 +137,16 @@ enum
      Sys_Packets_Command_Type      
 };
 
+/** The states of receiving a system packet byte by byte */
+enum
+{
+     Rx_State_Header = 0,
+     Rx_State_Length,
+     Rx_State_Body,
+     Rx_State_Bulk,
+     Rx_State_Bulk_Done
+};
+
 
 /**
  * \brief System packet structure
@@ -96,8 +161,8 @@ enum
  * | 4    | Command Type  |
  * | 5-62 | Data          |
  * | 63   | CRC           |
- * - Header is __System_Packet_Header
- * - The CRC byte is at the end of packets excluding in this structure.
+ * - Header is __System_Packet_Header or __System_Packet_Header_V2
+ * - The CRC byte (two bytes of version 2) is at the end of packets excluding in this structure.
  */
 typedef struct {
 	uint8_t     packet_header;
@@ -108,13 +173,22 @@ typedef struct {
 } system_packets_t;
 
 typedef void (*receive_packets_event)(system_packets_t * packet);
+typedef uint8_t (*receive_bulk_event)(uint8_t *data,uint8_t len);
 
 
 /*****************************************************************/
 void poll_system_packet_buffer(void);
+system_packets_t *peek_system_packet(void);
 void data_controller_init(receive_packets_event OnRxPacketEvent);
 void return_system_packets(system_packets_t *packet);
 void return_packets(system_packets_t *packet,uint8_t *Datas,uint8_t len);
 void return_system_packet_result(system_packets_t *packet,uint8_t Result);
+uint8_t get_packet_data_length(system_packets_t *packet);
+void capture_system_packet_result(uint8_t enable);
+uint8_t get_captured_result(void);
+uint8_t start_bulk_receive(system_packets_t *packet,uint16_t length,
+                           receive_bulk_event OnRxBulkEvent);
+uint8_t is_bulk_receiving(void);
+uint8_t poll_bulk_timeout(void);
 
 #endif
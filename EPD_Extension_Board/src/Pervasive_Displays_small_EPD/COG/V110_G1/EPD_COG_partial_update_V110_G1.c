@@ -285,8 +285,8 @@ void EPD_display_partialupdate(uint8_t EPD_type_index,
 	stage_handle_partial_update(EPD_type_index, previous_image_address,
 			new_image_address, mark_image_address, Stage2);
 
-	/** Power off COG Driver */
-	EPD_power_off(EPD_type_index);
+	/** Power off COG Driver unless power session is open */
+	if(!EPD_session_is_open()) EPD_power_off(EPD_type_index);
 	/** Save image combines with ASCII text  */
 	if (previous_image_address != new_image_address) {
 		save_partial_image(EPD_type_index, previous_image_address,
@@ -69,22 +69,113 @@ const struct COG_parameters_t COG_parameters[COUNT_OF_EPD_TYPE] = {
 	}
 };
 
-/* Temperature factor combines with stage time for each driving stage */
-const uint16_t temperature_table[3][8] = {
-	{(480*17),(480*12),(480*8),(480*4),(480*3),(480*2),(480*1),(480*0.7)},
-	{(480*17),(480*12),(480*8),(480*4),(480*3),(480*2),(480*1),(480*0.7)},
-	{(630*17),(630*12),(630*8),(630*4),(630*3),(630*2),(630*1),(630*0.7)},
+/* Temperature factor combines with stage time for each driving stage,
+ * T <= -10, -10 < T <= -5, ... 20 < T <= 40, T > 40 */
+const struct EPD_temperature_model_t EPD_temperature_model_default[COUNT_OF_EPD_TYPE] = {
+	{{(480*17),(480*12),(480*8),(480*4),(480*3),(480*2),(480*1),(480*0.7)},{-10,-5,5,10,15,20,40},7},
+	{{(480*17),(480*12),(480*8),(480*4),(480*3),(480*2),(480*1),(480*0.7)},{-10,-5,5,10,15,20,40},7},
+	{{(630*17),(630*12),(630*8),(630*4),(630*3),(630*2),(630*1),(630*0.7)},{-10,-5,5,10,15,20,40},7},
 };
 
 const uint8_t   SCAN_TABLE[4] = {0xC0,0x30,0x0C,0x03};
+
+/* Power on sequence, refer to the COG document Section 3 */
+static const struct EPD_power_step_t COG_power_on_sequence[] = {
+	/* Initial state */
+	SEQ_GPIO(SEQ_DISCHARGE,0),
+	SEQ_GPIO(SEQ_RST,0),
+	SEQ_GPIO(SEQ_CS,0),
+	SEQ_GPIO(SEQ_SPI_BUS,1),
+	SEQ_PWM(5),					//The PWM signal starts toggling
+	SEQ_GPIO(SEQ_VCC,1),		//Vcc and Vdd >= 2.7V
+	SEQ_PWM(10),
+	SEQ_GPIO(SEQ_CS,1),			// /CS=1
+	SEQ_GPIO(SEQ_BORDER,1),		//BORDER=1
+	SEQ_GPIO(SEQ_RST,1),		// /RESET=1
+	SEQ_PWM(5),
+	SEQ_GPIO(SEQ_RST,0),		// /RESET=0
+	SEQ_PWM(5),
+	SEQ_GPIO(SEQ_RST,1),		// /RESET=1
+	SEQ_PWM(5),
+	SEQ_END()
+};
+
+/* Initialize sequence, refer to the COG document Section 4 */
+static const struct EPD_power_step_t COG_initialize_sequence[] = {
+	SEQ_BUSY(ERROR_BUSY),
+	SEQ_SPI_CHANNEL(0x01),		// Channel select
+	SEQ_SPI(0x06,0xFF),			// DC/DC frequency setting
+	SEQ_SPI(0x07,0x9D),			// High power mode OSC setting
+	SEQ_SPI(0x08,0x00),			// Disable ADC
+	SEQ_SPI2(0x09,0xD0,0x00),	// Set Vcom level
+	SEQ_SPI_VOLTAGE(0x04),		// Gate and source voltage level
+	SEQ_PWM(5),
+	SEQ_SPI(0x03,0x01),			// Driver latch on (cancel register noise)
+	SEQ_SPI(0x03,0x00),			// Driver latch off
+	SEQ_SPI(0x05,0x01),			// Start charge pump positive V VGH & VDH on
+	SEQ_PWM(30),
+	SEQ_SPI(0x05,0x03),			// Start charge pump neg voltage VGL & VDL on
+	SEQ_DELAY(30),
+	SEQ_SPI(0x05,0x0F),			// Set charge pump Vcom_Driver to ON
+	SEQ_DELAY(30),
+	SEQ_SPI(0x02,0x24),			// Output enable to disable
+	SEQ_END()
+};
+
+/* Power off sequence after Nothing frame and Dummy line, refer to the COG document Section 6 */
+static const struct EPD_power_step_t COG_power_off_sequence[] = {
+	SEQ_DELAY(25),
+	SEQ_GPIO(SEQ_BORDER,0),
+	SEQ_DELAY(200),
+	SEQ_GPIO(SEQ_BORDER,1),
+	SEQ_SPI(0x03,0x01),			// Latch reset turn on
+	SEQ_SPI(0x02,0x05),			// Output enable off
+	SEQ_SPI(0x05,0x0E),			// Power off charge pump Vcom
+	SEQ_SPI(0x05,0x02),			// Power off charge negative voltage
+	SEQ_SPI(0x04,0x0C),			// Discharge
+	SEQ_DELAY(120),
+	SEQ_SPI(0x05,0x00),			// Turn off all charge pumps
+	SEQ_SPI(0x07,0x0D),			// Turn off osc
+	SEQ_SPI(0x04,0x50),			// Discharge internal
+	SEQ_DELAY(40),
+	SEQ_SPI(0x04,0xA0),			// Discharge internal
+	SEQ_DELAY(40),
+	SEQ_SPI(0x04,0x00),			// Discharge internal
+	/* Set power and signals = 0 */
+	SEQ_GPIO(SEQ_RST,0),
+	SEQ_GPIO(SEQ_SPI_BUS,0),
+	SEQ_GPIO(SEQ_CS,0),
+	SEQ_GPIO(SEQ_VCC,0),
+	SEQ_GPIO(SEQ_BORDER,0),
+	SEQ_GPIO(SEQ_DISCHARGE,1),	// External discharge = 1
+	SEQ_DELAY(150),
+	SEQ_GPIO(SEQ_DISCHARGE,0),	// External discharge = 0
+	SEQ_END()
+};
 static uint16_t stage_time;
 static COG_line_data_packet_type COG_Line;
 static EPD_read_flash_handler _On_EPD_read_flash;
 static uint16_t current_frame_time;
+/** The frame time of each EPD size averaged from the first frame of stages, it
+ *  predicts whether another frame fits in the stage before a frame is measured */
+static uint16_t learned_frame_time[COUNT_OF_EPD_TYPE];
+static uint8_t  frame_time_is_loaded;
 static uint8_t  *data_line_even;
 static uint8_t  *data_line_odd;
 static uint8_t  *data_line_scan;
 
+/** The state of updating from Flash memory step by step */
+static struct {
+	uint8_t EPD_type_index;
+	uint8_t stage_no;
+	uint8_t is_waiting;     /**< all frames are sent, wait for the rest of stage time */
+	uint8_t is_first_frame; /**< the first frame of stage measures the frame time */
+	uint16_t frame_time;    /**< the frame time measured in current stage */
+	uint16_t y;             /**< the next line to send */
+	long previous_image_address;
+	long new_image_address;
+} flash_update;
+
 /**
 * \brief According to EPD size and temperature to get stage_time
 * \note Refer to COG document Section 5.3 for more details
@@ -92,23 +183,66 @@ static uint8_t  *data_line_scan;
 * \param EPD_type_index The defined EPD size
 */
 static void set_temperature_factor(uint8_t EPD_type_index) {
-	int8_t temperature;
-	temperature = get_temperature();
-	if (temperature <= -10) {
-		stage_time = temperature_table[EPD_type_index][0];
-		} else if (-5 >= temperature && temperature > -10) {
-		stage_time = temperature_table[EPD_type_index][1];
-		} else if (5 >= temperature && temperature > -5) {
-		stage_time = temperature_table[EPD_type_index][2];
-		} else if (10 >= temperature && temperature > 5) {
-		stage_time = temperature_table[EPD_type_index][3];
-		} else if (15 >= temperature && temperature > 10) {
-		stage_time = temperature_table[EPD_type_index][4];
-		} else if (20 >= temperature && temperature > 15) {
-		stage_time = temperature_table[EPD_type_index][5];
-		} else if (40 >= temperature && temperature > 20) {
-		stage_time = temperature_table[EPD_type_index][6];
-	} else stage_time = temperature_table[EPD_type_index][7];
+	stage_time=EPD_get_temperature_time(EPD_type_index,get_temperature());
+}
+
+/**
+* \brief Load the learned frame time of each EPD size from information memory
+* \note The frame_time_offset of COG parameters is used if it isn't learned yet.
+*/
+static void load_frame_time(void) {
+	uint8_t i;
+	if(frame_time_is_loaded) return;
+	read_info_flash(learned_frame_time,sizeof(learned_frame_time));
+	for(i=0; i<COUNT_OF_EPD_TYPE; i++) {
+		if(learned_frame_time[i]==0xFFFF) learned_frame_time[i]=COG_parameters[i].frame_time_offset;
+	}
+	frame_time_is_loaded=TRUE;
+}
+
+/**
+* \brief Measure the frame time by the first frame of stage and average it into
+*        the learned frame time
+*
+* \note The average is weighted 1/4 to the new frame, the jitter of 1 mSec timer
+*       doesn't move it much.
+*
+* \param EPD_type_index The defined EPD size
+* \return The frame time measured in current stage
+*/
+static uint16_t learn_frame_time(uint8_t EPD_type_index) {
+	uint16_t frame_time=(uint16_t)get_current_time_tick();
+	learned_frame_time[EPD_type_index]=(uint16_t)
+		((learned_frame_time[EPD_type_index]*3UL+frame_time+2)>>2);
+	return frame_time;
+}
+
+/**
+* \brief Save the learned frame time to information memory
+*
+* \note
+* - It writes only if a frame time drifts more than 1/2^FRAME_TIME_SAVE_DRIFT_SHIFT
+*   of the saved value to save the erase cycles of flash.
+* - Writing information memory holds CPU with interrupts disabled for about
+*   13mSec, the update from Flash memory doesn't save by itself. The caller
+*   saves while the UART and EPD are idle.
+*
+* \return TRUE if the information memory is written
+*/
+uint8_t EPD_save_frame_time(void) {
+	uint8_t i;
+	uint16_t saved_frame_time[COUNT_OF_EPD_TYPE];
+	if(!frame_time_is_loaded) return FALSE;
+	read_info_flash(saved_frame_time,sizeof(saved_frame_time));
+	for(i=0; i<COUNT_OF_EPD_TYPE; i++) {
+		if(saved_frame_time[i]==0xFFFF ||
+		   abs((int16_t)(learned_frame_time[i]-saved_frame_time[i]))>
+		   (saved_frame_time[i]>>FRAME_TIME_SAVE_DRIFT_SHIFT)) {
+			write_info_flash(learned_frame_time,sizeof(learned_frame_time));
+			return TRUE;
+		}
+	}
+	return FALSE;
 }
 
 /**
@@ -155,24 +289,7 @@ void COG_driver_EPDtype_select(uint8_t EPD_type_index) {
 * \note For detailed flow and description, please refer to the COG document Section 3.
 */
 void EPD_power_on (void) {
-	/* Initial state */
-	EPD_discharge_low();
-	EPD_rst_low();
-	EPD_cs_low();
-	epd_spi_init();
-	epd_spi_attach();
-
-	PWM_run(5); //The PWM signal starts toggling
-	EPD_Vcc_turn_on(); //Vcc and Vdd >= 2.7V
-	PWM_run(10);
-	EPD_cs_high(); // /CS=1
-	EPD_border_high(); //BORDER=1
-	EPD_rst_high(); // /RESET=1
-	PWM_run(5);
-	EPD_rst_low(); // /RESET=0
-	PWM_run(5);
-	EPD_rst_high(); // /RESET=1
-	PWM_run(5);
+	EPD_power_sequence_run(COG_power_on_sequence,EPD_144);
 }
 
 
@@ -183,7 +300,6 @@ void EPD_power_on (void) {
 * \param EPD_type_index The defined EPD size
 */
 uint8_t EPD_initialize_driver (uint8_t EPD_type_index) {
-	uint8_t SendBuffer[2];
 	uint16_t k;
 
 	// Empty the Line buffer
@@ -195,53 +311,10 @@ uint8_t EPD_initialize_driver (uint8_t EPD_type_index) {
 
 	// Sense temperature to determine Temperature Factor
 	set_temperature_factor(EPD_type_index);
-	k = 0;
-	while (EPD_IsBusy()) {
-		if((k++) >= 0x0FFF) return ERROR_BUSY;
-	}
-	// Channel select
-	epd_spi_send (0x01, (uint8_t *)&COG_parameters[EPD_type_index].channel_select, 8);
-
-	// DC/DC frequency setting
-	epd_spi_send_byte (0x06, 0xFF);
-
-	// High power mode OSC setting
-	epd_spi_send_byte (0x07, 0x9D);
-
-	// Disable ADC
-	epd_spi_send_byte (0x08, 0x00);
-
-	// Set Vcom level
-	SendBuffer[0] = 0xD0;
-	SendBuffer[1] = 0x00;
-	epd_spi_send (0x09, SendBuffer, 2);
-
-	// Gate and source voltage level
-	epd_spi_send_byte (0x04,COG_parameters[EPD_type_index].voltage_level);
-	PWM_run(5);
-
-	// Driver latch on (cancel register noise)
-	epd_spi_send_byte(0x03, 0x01);
-
-	// Driver latch off
-	epd_spi_send_byte(0x03, 0x00);
 
-	// Start charge pump positive V VGH & VDH on
-	epd_spi_send_byte (0x05, 0x01);
-	PWM_run(30);
+	load_frame_time();
 
-	// Start charge pump neg voltage VGL & VDL on
-	epd_spi_send_byte (0x05, 0x03);
-	delay_ms (30);
-
-	// Set charge pump Vcom_Driver to ON
-	epd_spi_send_byte(0x05, 0x0F);
-	delay_ms(30);
-
-	// Output enable to disable
-	epd_spi_send_byte(0x02, 0x24);
-
-	return RES_OK;
+	return EPD_power_sequence_run(COG_initialize_sequence,EPD_type_index);
 }
 
 /**
@@ -269,8 +342,10 @@ static void stage_handle_array(uint8_t EPD_type_index,uint8_t *image_prt,uint8_t
 	uint16_t x,y,k;
 	static volatile uint8_t	temp_byte; // Temporary storage for image data check
 	uint8_t *backup_image_prt; // Backup image address pointer
+	uint8_t is_first_frame=TRUE;
+	uint16_t frame_time=learned_frame_time[EPD_type_index];
 	backup_image_prt = image_prt;
-	current_frame_time = COG_parameters[EPD_type_index].frame_time_offset;
+	current_frame_time = frame_time;
 	/* Start a system SysTick timer to ensure the same duration of each stage  */
 	start_EPD_timer();
 
@@ -376,144 +451,139 @@ static void stage_handle_array(uint8_t EPD_type_index,uint8_t *image_prt,uint8_t
 
 			data_line_scan[(y>>2)]=0;
 		}
-		/* Count the frame time with offset */
-		current_frame_time=(uint16_t)get_current_time_tick()+
-			COG_parameters[EPD_type_index].frame_time_offset;
+		/* Learn the frame time by the first frame, then count the frame time
+		 * to predict whether another frame fits in stage time */
+		if(is_first_frame) {
+			frame_time=learn_frame_time(EPD_type_index);
+			is_first_frame=FALSE;
+		}
+		current_frame_time=(uint16_t)get_current_time_tick()+frame_time;
 	} while (stage_time>current_frame_time);
 
-	/* Do while the SysTick timer fulfills the stage time */
-	while(stage_time>get_current_time_tick());
+	/* Sleep until the SysTick timer fulfills the stage time */
+	current_frame_time=(uint16_t)get_current_time_tick();
+	if(stage_time>current_frame_time) delay_ms(stage_time-current_frame_time);
 
 	/* Stop system timer */
 	stop_EPD_timer();
 }
 
 /**
- * \brief The driving stages for getting Odd/Even data and writing the data
- * from Flash memory to COG
+ * \brief Get Odd/Even data of one line from Flash memory and write it to COG
  *
  * \note
  * - Refer to stage_handle_array comment note.
  * - For more details on the driving stages, please refer to the COG document Section 5.
  *
  * \param EPD_type_index The defined EPD size
- * \param image_data_address The address of flash memory that stores image
+ * \param image_data_address The address of flash memory that stores the line
  * \param stage_no The assigned stage number that will proceed
+ * \param y The line number
  */
-static void stage_handle_flash(uint8_t EPD_type_index,long image_data_address,uint8_t stage_no) {
-	/* x for horizontal_size loop, y for vertical_size loop, which are EPD pixel size */
-	uint16_t x,y,k;
+static void line_handle_flash(uint8_t EPD_type_index,long image_data_address,uint8_t stage_no,
+                              uint16_t y) {
+	/* x for horizontal_size loop, which are EPD pixel size */
+	uint16_t x,k;
 	static volatile uint8_t	temp_byte; // Temporary storage for image data check
-	long original_image_address; // Backup original image address
 	uint8_t byte_array[LINE_BUFFER_DATA_SIZE];
-	original_image_address=image_data_address;
-	current_frame_time=COG_parameters[EPD_type_index].frame_time_offset;
-
-	/* Start a system SysTick timer to ensure the same duration of each stage  */
-	start_EPD_timer();
-
-	/* Do while total time of frames exceed stage time
-	* Per frame */
-	do {
-		image_data_address=original_image_address;
-
-		/* Per data line (vertical size) */
-		for (y = 0; y < COG_parameters[EPD_type_index].vertical_size; y++){
-			/* Set charge pump voltage level reduce voltage shift */
-			epd_spi_send_byte (0x04, COG_parameters[EPD_type_index].voltage_level);
-
-			k = COG_parameters[EPD_type_index].horizontal_size-1;
-			if(_On_EPD_read_flash!=NULL) {
-				_On_EPD_read_flash(image_data_address,(uint8_t *)&byte_array,
-				COG_parameters[EPD_type_index].horizontal_size);
-			}
+	/* Set charge pump voltage level reduce voltage shift */
+	epd_spi_send_byte (0x04, COG_parameters[EPD_type_index].voltage_level);
 
-			for (x = 0; x < COG_parameters[EPD_type_index].horizontal_size; x++){
-				temp_byte =byte_array[x];
-				switch(stage_no) {
-					case Stage1: // Compensate, Inverse previous image
-					/* See the stage #1 example in stage_handle_array */
-					data_line_odd[x]	 =  ((temp_byte & 0x80) ? BLACK3  : WHITE3);
-					data_line_odd[x]	|=  ((temp_byte & 0x20) ? BLACK2  : WHITE2);
-					data_line_odd[x]	|=  ((temp_byte & 0x08) ? BLACK1  : WHITE1);
-					data_line_odd[x]	|=  ((temp_byte & 0x02) ? BLACK0  : WHITE0);
-
-					data_line_even[k]    = ((temp_byte & 0x01) ? BLACK3  : WHITE3);
-					data_line_even[k]   |= ((temp_byte & 0x04) ? BLACK2  : WHITE2);
-					data_line_even[k]   |= ((temp_byte & 0x10) ? BLACK1  : WHITE1);
-					data_line_even[k--] |= ((temp_byte & 0x40) ? BLACK0  : WHITE0);
-						break;
+	k = COG_parameters[EPD_type_index].horizontal_size-1;
+	if(_On_EPD_read_flash!=NULL) {
+		_On_EPD_read_flash(image_data_address,(uint8_t *)&byte_array,
+		COG_parameters[EPD_type_index].horizontal_size);
+	}
 
-					case Stage2: // White
-					data_line_odd[x] 	 =  ((temp_byte & 0x80) ?  WHITE3 : NOTHING3);
-					data_line_odd[x]	|=  ((temp_byte & 0x20) ?  WHITE2 : NOTHING2);
-					data_line_odd[x]	|=  ((temp_byte & 0x08) ?  WHITE1 : NOTHING1);
-					data_line_odd[x]	|=  ((temp_byte & 0x02) ?  WHITE0 : NOTHING0);
-
-					data_line_even[k]    =  ((temp_byte & 0x01) ?  WHITE3 : NOTHING3);
-					data_line_even[k]   |=  ((temp_byte & 0x04) ?  WHITE2 : NOTHING2);
-					data_line_even[k]   |=  ((temp_byte & 0x10) ?  WHITE1 : NOTHING1);
-					data_line_even[k--] |=  ((temp_byte & 0x40) ?  WHITE0 : NOTHING0);
-						break;
+	for (x = 0; x < COG_parameters[EPD_type_index].horizontal_size; x++){
+		temp_byte =byte_array[x];
+		switch(stage_no) {
+			case Stage1: // Compensate, Inverse previous image
+			/* See the stage #1 example in stage_handle_array */
+			data_line_odd[x]	 =  ((temp_byte & 0x80) ? BLACK3  : WHITE3);
+			data_line_odd[x]	|=  ((temp_byte & 0x20) ? BLACK2  : WHITE2);
+			data_line_odd[x]	|=  ((temp_byte & 0x08) ? BLACK1  : WHITE1);
+			data_line_odd[x]	|=  ((temp_byte & 0x02) ? BLACK0  : WHITE0);
+
+			data_line_even[k]    = ((temp_byte & 0x01) ? BLACK3  : WHITE3);
+			data_line_even[k]   |= ((temp_byte & 0x04) ? BLACK2  : WHITE2);
+			data_line_even[k]   |= ((temp_byte & 0x10) ? BLACK1  : WHITE1);
+			data_line_even[k--] |= ((temp_byte & 0x40) ? BLACK0  : WHITE0);
+				break;
 
-					case Stage3: // Inverse new image
-					data_line_odd[x]     = ((temp_byte & 0x80) ? BLACK3  : NOTHING3);
-					data_line_odd[x]    |= ((temp_byte & 0x20) ? BLACK2  : NOTHING2);
-					data_line_odd[x]    |= ((temp_byte & 0x08) ? BLACK1  : NOTHING1);
-					data_line_odd[x]    |= ((temp_byte & 0x02) ? BLACK0  : NOTHING0);
+			case Stage2: // White
+			data_line_odd[x] 	 =  ((temp_byte & 0x80) ?  WHITE3 : NOTHING3);
+			data_line_odd[x]	|=  ((temp_byte & 0x20) ?  WHITE2 : NOTHING2);
+			data_line_odd[x]	|=  ((temp_byte & 0x08) ?  WHITE1 : NOTHING1);
+			data_line_odd[x]	|=  ((temp_byte & 0x02) ?  WHITE0 : NOTHING0);
 
-					data_line_even[k]    = ((temp_byte & 0x01) ? BLACK3  : NOTHING3);
-					data_line_even[k]   |= ((temp_byte & 0x04) ? BLACK2  : NOTHING2);
-					data_line_even[k]   |= ((temp_byte & 0x10) ? BLACK1  : NOTHING1);
-					data_line_even[k--] |= ((temp_byte & 0x40) ? BLACK0  : NOTHING0);
-						break;
+			data_line_even[k]    =  ((temp_byte & 0x01) ?  WHITE3 : NOTHING3);
+			data_line_even[k]   |=  ((temp_byte & 0x04) ?  WHITE2 : NOTHING2);
+			data_line_even[k]   |=  ((temp_byte & 0x10) ?  WHITE1 : NOTHING1);
+			data_line_even[k--] |=  ((temp_byte & 0x40) ?  WHITE0 : NOTHING0);
+				break;
 
-					case Stage4: // New image
-					data_line_odd[x]     = ((temp_byte & 0x80) ? WHITE3  : BLACK3 );
-					data_line_odd[x]    |= ((temp_byte & 0x20) ? WHITE2  : BLACK2 );
-					data_line_odd[x]    |= ((temp_byte & 0x08) ? WHITE1  : BLACK1 );
-					data_line_odd[x]    |= ((temp_byte & 0x02) ? WHITE0  : BLACK0 );
+			case Stage3: // Inverse new image
+			data_line_odd[x]     = ((temp_byte & 0x80) ? BLACK3  : NOTHING3);
+			data_line_odd[x]    |= ((temp_byte & 0x20) ? BLACK2  : NOTHING2);
+			data_line_odd[x]    |= ((temp_byte & 0x08) ? BLACK1  : NOTHING1);
+			data_line_odd[x]    |= ((temp_byte & 0x02) ? BLACK0  : NOTHING0);
 
-					data_line_even[k]    = ((temp_byte & 0x01) ? WHITE3  : BLACK3 );
-					data_line_even[k]   |= ((temp_byte & 0x04) ? WHITE2  : BLACK2 );
-					data_line_even[k]   |= ((temp_byte & 0x10) ? WHITE1  : BLACK1 );
-					data_line_even[k--] |= ((temp_byte & 0x40) ? WHITE0  : BLACK0 );
-						break;
+			data_line_even[k]    = ((temp_byte & 0x01) ? BLACK3  : NOTHING3);
+			data_line_even[k]   |= ((temp_byte & 0x04) ? BLACK2  : NOTHING2);
+			data_line_even[k]   |= ((temp_byte & 0x10) ? BLACK1  : NOTHING1);
+			data_line_even[k--] |= ((temp_byte & 0x40) ? BLACK0  : NOTHING0);
+				break;
 
-                }
-            }
-			image_data_address+=LINE_SIZE;
-			/* Scan byte shift per data line */
-			data_line_scan[(y>>2)]= SCAN_TABLE[(y%4)];
+			case Stage4: // New image
+			data_line_odd[x]     = ((temp_byte & 0x80) ? WHITE3  : BLACK3 );
+			data_line_odd[x]    |= ((temp_byte & 0x20) ? WHITE2  : BLACK2 );
+			data_line_odd[x]    |= ((temp_byte & 0x08) ? WHITE1  : BLACK1 );
+			data_line_odd[x]    |= ((temp_byte & 0x02) ? WHITE0  : BLACK0 );
 
-			/* For 1.44 inch EPD, the border uses the internal signal control byte. */
-			if(EPD_type_index==EPD_144)
-				COG_Line.line_data_by_size.line_data_for_144.border_byte=0x00;
+			data_line_even[k]    = ((temp_byte & 0x01) ? WHITE3  : BLACK3 );
+			data_line_even[k]   |= ((temp_byte & 0x04) ? WHITE2  : BLACK2 );
+			data_line_even[k]   |= ((temp_byte & 0x10) ? WHITE1  : BLACK1 );
+			data_line_even[k--] |= ((temp_byte & 0x40) ? WHITE0  : BLACK0 );
+				break;
+		}
+	}
+	/* Scan byte shift per data line */
+	data_line_scan[(y>>2)]= SCAN_TABLE[(y%4)];
 
-			/* Sending data */
-			epd_spi_send (0x0A, (uint8_t *)&COG_Line.uint8,
-				COG_parameters[EPD_type_index].data_line_size);
+	/* For 1.44 inch EPD, the border uses the internal signal control byte. */
+	if(EPD_type_index==EPD_144)
+		COG_Line.line_data_by_size.line_data_for_144.border_byte=0x00;
 
-			/* Turn on Output Enable */
-			epd_spi_send_byte (0x02, 0x2F);
+	/* Sending data */
+	epd_spi_send (0x0A, (uint8_t *)&COG_Line.uint8,
+		COG_parameters[EPD_type_index].data_line_size);
 
-			data_line_scan[(y>>2)]=0;
-		}
-		/* Count the frame time with offset */
-		current_frame_time=(uint16_t)get_current_time_tick()+
-			COG_parameters[EPD_type_index].frame_time_offset ;
-	} while (stage_time>current_frame_time);
+	/* Turn on Output Enable */
+	epd_spi_send_byte (0x02, 0x2F);
 
-	/* Do while the SysTick timer fulfills the stage time */
-	while(stage_time>get_current_time_tick());
+	data_line_scan[(y>>2)]=0;
+}
 
-	/* Stop system timer */
-	stop_EPD_timer();
+/**
+ * \brief Start the driving stage of updating from Flash memory
+ *
+ * \note The timer is started to ensure the same duration of each stage.
+ */
+static void stage_begin_flash(void) {
+	flash_update.y=0;
+	flash_update.is_waiting=FALSE;
+	flash_update.is_first_frame=TRUE;
+	flash_update.frame_time=learned_frame_time[flash_update.EPD_type_index];
+	current_frame_time=flash_update.frame_time;
+	start_EPD_timer();
 }
 
 /**
 * \brief Write image data from memory array to the EPD
-* \note For more detail on driving stages, please refer to COG document Section 5.
+* \note
+* - For more detail on driving stages, please refer to COG document Section 5.
+* - The learned frame time is saved at the end, the update holds CPU anyway.
 *
 * \param EPD_type_index The defined EPD size
 * \param previous_image_ptr The pointer of memory that stores previous image
@@ -525,6 +595,74 @@ uint8_t *new_image_ptr) {
 	stage_handle_array(EPD_type_index,previous_image_ptr,Stage2);
 	stage_handle_array(EPD_type_index,new_image_ptr,Stage3);
 	stage_handle_array(EPD_type_index,new_image_ptr,Stage4);
+	EPD_save_frame_time();
+}
+
+/**
+* \brief Start writing image data from Flash memory to the EPD
+* \note The update proceeds by calling EPD_display_step until it returns RES_OK.
+*
+* \param EPD_type_index The defined EPD size
+* \param previous_image_flash_address The previous image address of flash memory
+* \param new_image_flash_address The new image address of flash memory
+* \param On_EPD_read_flash Developer needs to create an external function to read flash
+*/
+void EPD_display_from_flash_begin (uint8_t EPD_type_index, long previous_image_flash_address,
+     long new_image_flash_address,EPD_read_flash_handler On_EPD_read_flash) {
+	_On_EPD_read_flash=On_EPD_read_flash;
+	flash_update.EPD_type_index=EPD_type_index;
+	flash_update.previous_image_address=previous_image_flash_address;
+	flash_update.new_image_address=new_image_flash_address;
+	flash_update.stage_no=Stage1;
+	stage_begin_flash();
+}
+
+/**
+* \brief Proceed the update from Flash memory by EPD_LINES_PER_STEP lines
+*
+* \note
+* - The frames of a stage repeat until the stage time is fulfilled, then the
+*   next stage starts after the rest of stage time. It never waits here.
+* - Stage 1 and 2 use previous image, stage 3 and 4 use new image.
+*
+* \return RES_BUSY if the update is in progress, or RES_OK when it is done
+*/
+uint8_t EPD_display_step (void) {
+	uint8_t n;
+	uint8_t EPD_type_index=flash_update.EPD_type_index;
+	long image_data_address;
+	if(flash_update.stage_no>Stage4) return RES_OK;
+	if(!flash_update.is_waiting) {
+		image_data_address=((flash_update.stage_no<Stage3) ? flash_update.previous_image_address :
+		                    flash_update.new_image_address)+(long)flash_update.y*LINE_SIZE;
+		for(n=0; n<EPD_LINES_PER_STEP; n++) {
+			line_handle_flash(EPD_type_index,image_data_address,
+			                  flash_update.stage_no,flash_update.y);
+			image_data_address+=LINE_SIZE;
+			if((++flash_update.y)<COG_parameters[EPD_type_index].vertical_size) continue;
+
+			/* Learn the frame time by the first frame, then count the frame
+			 * time, repeat the frame if another one fits in stage time */
+			if(flash_update.is_first_frame) {
+				flash_update.frame_time=learn_frame_time(EPD_type_index);
+				flash_update.is_first_frame=FALSE;
+			}
+			current_frame_time=(uint16_t)get_current_time_tick()+flash_update.frame_time;
+			if(stage_time>current_frame_time) flash_update.y=0;
+			else flash_update.is_waiting=TRUE;
+			break;
+		}
+		return RES_BUSY;
+	}
+
+	/* Wait until the SysTick timer fulfills the stage time */
+	if(stage_time>get_current_time_tick()) return RES_BUSY;
+
+	/* Stop system timer */
+	stop_EPD_timer();
+	if((++flash_update.stage_no)>Stage4) return RES_OK;
+	stage_begin_flash();
+	return RES_BUSY;
 }
 
 /**
@@ -537,11 +675,9 @@ uint8_t *new_image_ptr) {
 */
 void EPD_display_from_flash_prt (uint8_t EPD_type_index, long previous_image_flash_address,
      long new_image_flash_address,EPD_read_flash_handler On_EPD_read_flash) {
-	_On_EPD_read_flash=On_EPD_read_flash;
-	stage_handle_flash(EPD_type_index,previous_image_flash_address,Stage1);
-	stage_handle_flash(EPD_type_index,previous_image_flash_address,Stage2);
-	stage_handle_flash(EPD_type_index,new_image_flash_address     ,Stage3);
-	stage_handle_flash(EPD_type_index,new_image_flash_address     ,Stage4);
+	EPD_display_from_flash_begin(EPD_type_index,previous_image_flash_address,
+	                             new_image_flash_address,On_EPD_read_flash);
+	while(EPD_display_step()==RES_BUSY);
 }
 
 /**
@@ -615,58 +751,6 @@ uint8_t EPD_power_off (uint8_t EPD_type_index) {
 	nothing_frame (EPD_type_index);
 
 	dummy_line(EPD_type_index);
-	delay_ms (25);
-
-	EPD_border_low();
-	delay_ms (200);
-
-	EPD_border_high();
-	// Latch reset turn on
-	epd_spi_send_byte (0x03, 0x01);
-
-	// Output enable off
-	epd_spi_send_byte (0x02, 0x05);
-
-	// Power off charge pump Vcom
-	epd_spi_send_byte (0x05, 0x0E);
-
-	// Power off charge negative voltage
-	epd_spi_send_byte (0x05, 0x02);
-
-	// Discharge
-	epd_spi_send_byte (0x04, 0x0C);
-	delay_ms (120);
-
-	// Turn off all charge pumps
-	epd_spi_send_byte (0x05, 0x00);
-
-	// Turn off osc
-	epd_spi_send_byte (0x07, 0x0D);
-
-	// Discharge internal
-	epd_spi_send_byte (0x04, 0x50);
-	delay_ms (40);
-
-	// Discharge internal
-	epd_spi_send_byte (0x04, 0xA0);
-	delay_ms (40);
-
-	// Discharge internal
-	epd_spi_send_byte (0x04, 0x00);
-
-	// Set power and signals = 0
-	EPD_rst_low ();
-	epd_spi_detach ();
-	EPD_cs_low ();
-	EPD_Vcc_turn_off ();
-	EPD_border_low();
-
-	// External discharge = 1
-	EPD_discharge_high ();
-	delay_ms (150);
-
-	// External discharge = 0
-	EPD_discharge_low ();
 
-	return RES_OK;
+	return EPD_power_sequence_run(COG_power_off_sequence,EPD_type_index);
 }
@@ -78,6 +78,82 @@ const struct COG_parameters_t COG_parameters[COUNT_OF_EPD_TYPE]  = {
 	}
 };
 
+/* Power on sequence, refer to the COG G2 document Section 3 */
+static const struct EPD_power_step_t COG_power_on_sequence[] = {
+	/* Initial state */
+	SEQ_GPIO(SEQ_VCC,1),		//Vcc and Vdd >= 2.7V
+	SEQ_GPIO(SEQ_CS,1),
+	SEQ_GPIO(SEQ_BORDER,1),
+	SEQ_GPIO(SEQ_RST,1),
+	SEQ_DELAY(5),
+	SEQ_GPIO(SEQ_RST,0),
+	SEQ_DELAY(5),
+	SEQ_GPIO(SEQ_RST,1),
+	SEQ_DELAY(5),
+	SEQ_END()
+};
+
+/* Initialize sequence, refer to the COG G2 document Section 4
+ * \note Charge pump phases of VGH & VDH and VGL & VDL have no status to check,
+ *       the Vcom phase ends as soon as DC/DC is ready.
+ * */
+static const struct EPD_power_step_t COG_initialize_sequence[] = {
+	SEQ_BUSY(ERROR_BUSY),
+	SEQ_CHECK(0x72,0x0F,0x02,ERROR_COG_ID),		//Check COG ID
+	SEQ_SPI(0x02,0x40),							//Disable OE
+	SEQ_CHECK(0x0F,0x80,0x80,ERROR_BREAKAGE),	//Check Breakage
+	SEQ_SPI(0x0B,0x02),							//Power Saving Mode
+	SEQ_SPI_CHANNEL(0x01),						//Channel Select
+	SEQ_SPI(0x07,0xD1),							//High Power Mode Osc Setting
+	SEQ_SPI(0x08,0x02),							//Power Setting
+	SEQ_SPI(0x09,0xC2),							//Set Vcom level
+	SEQ_SPI(0x04,0x03),							//Power Setting
+	SEQ_SPI(0x03,0x01),							//Driver latch on
+	SEQ_SPI(0x03,0x00),							//Driver latch off
+	SEQ_DELAY(5),
+	/* Chargepump Start */
+	SEQ_SPI(0x05,0x01),							//VGH & VDH on
+	SEQ_DELAY(240),
+	SEQ_SPI(0x05,0x03),							//VGL & VDL on
+	SEQ_DELAY(40),
+	SEQ_SPI(0x05,0x0F),							//Vcom_Driver on
+	SEQ_DELAY(5),
+	SEQ_POLL(0x0F,0x40,0x40,35),				//Check DC/DC
+	SEQ_RETRY(7,4,ERROR_CHARGEPUMP),
+	SEQ_END()
+};
+
+/* Power off sequence after Border Dummy line, refer to the COG G2 document Section 6 */
+static const struct EPD_power_step_t COG_power_off_sequence[] = {
+	SEQ_DELAY(25),
+	SEQ_SIZE((1<<EPD_270),3),
+	SEQ_GPIO(SEQ_BORDER,0),
+	SEQ_DELAY(200),
+	SEQ_GPIO(SEQ_BORDER,1),
+	SEQ_CHECK(0x0F,0x40,0x40,ERROR_DC),			//Check DC/DC
+	SEQ_SPI(0x03,0x01),							//Turn on Latch Reset
+	SEQ_SPI(0x02,0x05),							//Turn off OE
+	SEQ_SPI(0x05,0x0E),							//Power off charge pump Vcom
+	SEQ_SPI(0x05,0x02),							//Power off charge pump neg voltage
+	SEQ_SPI(0x05,0x00),							//Turn off all charge pump
+	SEQ_SPI(0x07,0x0D),							//Turn off OSC
+	SEQ_SPI(0x04,0x83),
+	SEQ_DELAY(120),
+	SEQ_SPI(0x04,0x00),
+	SEQ_GPIO(SEQ_SPI_BUS,0),
+	SEQ_GPIO(SEQ_CS,0),
+	SEQ_GPIO(SEQ_RST,0),
+	SEQ_GPIO(SEQ_VCC,0),
+	SEQ_GPIO(SEQ_BORDER,0),
+	SEQ_DELAY(10),
+	SEQ_GPIO(SEQ_DISCHARGE,1),
+	SEQ_DELAY(10),
+	SEQ_GPIO(SEQ_DISCHARGE,0),
+	SEQ_DELAY(10),
+	SEQ_LOOP(4,10),
+	SEQ_END()
+};
+
 /* \brief EPD Waveform parameters
  * \note the parameters of waveform table below is different from the G2 COG document due to
  *       use block size is easier to achieve than accurate block time for different MCU.
@@ -193,9 +269,18 @@ const struct COG_parameters_t COG_parameters[COUNT_OF_EPD_TYPE]  = {
 	 
  };
 
+/* The stage2_t1 and stage2_t2 of waveform table by temperature,
+ * T <= 0, 0 < T <= 10, 10 < T <= 40, 40 < T <= 50, T > 50 */
+const struct EPD_temperature_model_t EPD_temperature_model_default[COUNT_OF_EPD_TYPE] = {
+	{{155,392,155,155,155},{0,10,40,50},4},
+	{{196,392,196,196,196},{0,10,40,50},4},
+	{{196,392,196,196,196},{0,10,40,50},4},
+};
+
 const uint8_t   SCAN_TABLE[4] = {0xC0,0x30,0x0C,0x03};
 	
-static struct EPD_WaveformTable_Struct *action__Waveform_param;
+static struct EPD_WaveformTable_Struct action_waveform; /**< the waveform of current temperature */
+static struct EPD_WaveformTable_Struct *action__Waveform_param=&action_waveform;
 static COG_line_data_packet_type COG_Line;
 static EPD_read_flash_handler _On_EPD_read_flash;
 static uint8_t  *data_line_even;
@@ -203,6 +288,21 @@ static uint8_t  *data_line_odd;
 static uint8_t  *data_line_scan;
 static uint8_t  *data_line_border_byte;
 
+/** The state of driving stages step by step */
+static struct {
+	uint8_t EPD_type_index;
+	uint8_t stage_no;
+	uint8_t last_stage;
+	uint8_t lineoffset;
+	uint8_t isLastBlock; /**< If the beginning line of block is in active range of EPD */
+	uint8_t *image_prt;
+	long image_data_address;
+	int16_t cycle;       /**< the frame of Block type, or the black/white frame of Frame type */
+	int16_t m;           /**< the step of Block type */
+	int16_t i;           /**< the next line to send */
+	struct EPD_V230_G2_Struct S_epd_v230;
+} stage_update;
+
 /**
 * \brief According to EPD size and temperature to get stage_time
 * \note Refer to COG document Section 5.3 for more details
@@ -210,15 +310,21 @@ static uint8_t  *data_line_border_byte;
 * \param EPD_type_index The defined EPD size
 */
 static void set_temperature_factor(uint8_t EPD_type_index) {
-	int8_t temperature;
+	int16_t temperature;
+	uint8_t row;
 	temperature = get_temperature();	
-        if (50 >= temperature  && temperature > 40){
-			action__Waveform_param=(struct EPD_WaveformTable_Struct *)&E_Waveform[EPD_type_index][0];
-		}else if (40 >= temperature  && temperature > 10){
-			action__Waveform_param=(struct EPD_WaveformTable_Struct *)&E_Waveform[EPD_type_index][1];
-		}else if (10 >= temperature  && temperature > 0){
-			action__Waveform_param=(struct EPD_WaveformTable_Struct *)&E_Waveform[EPD_type_index][2];
-		}else action__Waveform_param=(struct EPD_WaveformTable_Struct *)&E_Waveform[EPD_type_index][1]; //Default
+	if (50 >= temperature  && temperature > 40){
+		row=0;
+	}else if (40 >= temperature  && temperature > 10){
+		row=1;
+	}else if (10 >= temperature  && temperature > 0){
+		row=2;
+	}else row=1; //Default
+	
+	/* The stage 2 time follows temperature model */
+	action_waveform=E_Waveform[EPD_type_index][row];
+	action_waveform.stage2_t1=EPD_get_temperature_time(EPD_type_index,temperature);
+	action_waveform.stage2_t2=action_waveform.stage2_t1;
 }
 
 /**
@@ -264,17 +370,8 @@ void COG_driver_EPDtype_select(uint8_t EPD_type_index) {
 * \brief Power on COG Driver
 * \note For detailed flow and description, please refer to the COG G2 document Section 3.
 */
-void EPD_power_on (void) {	
-	/* Initial state */
-	EPD_Vcc_turn_on(); //Vcc and Vdd >= 2.7V	
-	EPD_cs_high();
-	EPD_border_high();
-	EPD_rst_high();
-	delay_ms(5);	
-	EPD_rst_low();
-	delay_ms(5);
-	EPD_rst_high();
-	delay_ms(5);
+void EPD_power_on (void) {
+	EPD_power_sequence_run(COG_power_on_sequence,EPD_144);
 }
 
 
@@ -296,81 +393,11 @@ uint8_t EPD_initialize_driver (uint8_t EPD_type_index) {
 
 	// Sense temperature to determine Temperature Factor
 	set_temperature_factor(EPD_type_index);
-	i = 0;
-	
-	while (EPD_IsBusy()) {
-		if((i++) >= 0x0FFF) return ERROR_BUSY;
-	}
-	
-	//Check COG ID
-	if((SPI_R(0x72,0x00) & 0x0f) !=0x02) return ERROR_COG_ID;
-
-	//Disable OE
-	epd_spi_send_byte(0x02,0x40);	
-
-	//Check Breakage
-	if((SPI_R(0x0F,0x00) & 0x80) != 0x80) return ERROR_BREAKAGE;
-	
-	//Power Saving Mode
- 	epd_spi_send_byte(0x0B, 0x02);
-
-	//Channel Select
-	epd_spi_send (0x01, (uint8_t *)&COG_parameters[EPD_type_index].channel_select, 8);
-
-	//High Power Mode Osc Setting
-	epd_spi_send_byte(0x07,0xD1);
-
-	//Power Setting
-	epd_spi_send_byte(0x08,0x02);
-
-	//Set Vcom level
-	epd_spi_send_byte(0x09,0xC2);
-
-	//Power Setting
-	epd_spi_send_byte(0x04,0x03);
-
-	//Driver latch on
-	epd_spi_send_byte(0x03,0x01);
-
-	//Driver latch off
-	epd_spi_send_byte(0x03,0x00);
-
-	delay_ms(5);
-
-	//Chargepump Start
-	i=0;
-	do {
-		//Start chargepump positive V
-		//VGH & VDH on
-		epd_spi_send_byte(0x05,0x01);
-
-		delay_ms(240);
-
-		//Start chargepump neg voltage
-		//VGL & VDL on
-		epd_spi_send_byte(0x05,0x03);
-
-		delay_ms(40);
-
-		//Set chargepump
-		//Vcom_Driver to ON
-		//Vcom_Driver on
-		epd_spi_send_byte(0x05,0x0F);
-
-		delay_ms(40);
-
-		//Check DC/DC
-		if((SPI_R(0x0F,0x00) & 0x40) != 0x00) break;	
-		
-	}while((i++) != 4);
 	
-	if(i>=4) 
-	{
-		//Output enable to disable
-		epd_spi_send_byte(0x02,0x40);
-		return ERROR_CHARGEPUMP;
-	}
-	else  return RES_OK;
+	i=EPD_power_sequence_run(COG_initialize_sequence,EPD_type_index);
+	//Output enable to disable
+	if(i==ERROR_CHARGEPUMP) epd_spi_send_byte(0x02,0x40);
+	return i;
 }
 
 /**
@@ -400,38 +427,54 @@ void stage_init(uint8_t EPD_type_index,struct EPD_V230_G2_Struct *S_epd_v230,
 }
 
 /**
-* \brief For Frame type waveform to update all black/white pattern
-*
-* \param EPD_type_index The defined EPD size
-* \param bwdata Black or White color to whole screen
-* \param work_time The working time
+* \brief Start a frame type waveform to update all black/white pattern
+* \note Black and white frames alternate by the counter of frame type waveform.
 */
-static inline void same_data_frame (uint8_t EPD_type_index, uint8_t bwdata, uint32_t work_time) {
+static void same_data_begin (void) {
 	uint16_t i;
-	for (i = 0; i <  COG_parameters[EPD_type_index].horizontal_size; i++) {
+	uint8_t bwdata;
+	bwdata=(stage_update.cycle & 1) ? ALL_WHITE : ALL_BLACK;
+	for (i = 0; i <  COG_parameters[stage_update.EPD_type_index].horizontal_size; i++) {
 		data_line_even[i]=bwdata;
 		data_line_odd[i]=bwdata;
 	}
+	stage_update.i=0;
 	start_EPD_timer();
-	do 
-	{	
-		for (i = 0; i < COG_parameters[EPD_type_index].vertical_size; i++) {
-			
-			/* Scan byte shift per data line */
-			data_line_scan[(i>>2)]=SCAN_TABLE[(i%4)];
-			
-			/* Sending data */
-			epd_spi_send (0x0A, (uint8_t *)&COG_Line.uint8, COG_parameters[EPD_type_index].data_line_size);
-		 
-			/* Turn on Output Enable */
-			epd_spi_send_byte (0x02, 0x07);
-		
-			data_line_scan[(i>>2)]=0;
-			
-		}
-	} while (get_current_time_tick()<(work_time));
-		/* Stop system timer */
-		stop_EPD_timer();
+}
+
+/**
+* \brief Write one line of frame type waveform
+* \note The frames repeat until the working time t1(black) or t2(white) is fulfilled.
+*
+* \return TRUE if all black/white frames of Stage 2 are done
+*/
+static uint8_t same_data_line (void) {
+	uint8_t EPD_type_index=stage_update.EPD_type_index;
+	int16_t i=stage_update.i;
+	uint32_t work_time;
+
+	/* Scan byte shift per data line */
+	data_line_scan[(i>>2)]=SCAN_TABLE[(i%4)];
+
+	/* Sending data */
+	epd_spi_send (0x0A, (uint8_t *)&COG_Line.uint8, COG_parameters[EPD_type_index].data_line_size);
+
+	/* Turn on Output Enable */
+	epd_spi_send_byte (0x02, 0x07);
+
+	data_line_scan[(i>>2)]=0;
+
+	if((++stage_update.i)<COG_parameters[EPD_type_index].vertical_size) return FALSE;
+	stage_update.i=0;
+	work_time=(stage_update.cycle & 1) ? action__Waveform_param->stage2_t2 :
+	          action__Waveform_param->stage2_t1;
+	if(get_current_time_tick()<work_time) return FALSE;
+
+	/* Stop system timer */
+	stop_EPD_timer();
+	if((++stage_update.cycle)>=(action__Waveform_param->stage2_cycle*2)) return TRUE;
+	same_data_begin();
+	return FALSE;
 }
 
 /**
@@ -528,156 +571,183 @@ void read_line_data_handle(uint8_t EPD_type_index,uint8_t *image_prt,uint8_t sta
 
 
 /**
-* \brief The base function to handle the driving stages for Frame and Block type
-*
-* \note
-* - There are 3 stages to complete an image update on COG_V230_G2 type EPD.
-* - For more details on the driving stages, please refer to the COG G2 document Section 5.4
+* \brief Move the block to next step of Block type waveform
+*/
+static void block_step_begin(void)
+{
+	struct EPD_V230_G2_Struct *S_epd_v230=&stage_update.S_epd_v230;
+	S_epd_v230->block_y1 += S_epd_v230->step_size;
+	S_epd_v230->block_y0 = S_epd_v230->block_y1 - S_epd_v230->block_size;
+	/* reset block_y0=frame_y0 if block is not in active range of EPD */
+	if (S_epd_v230->block_y0 < S_epd_v230->frame_y0) S_epd_v230->block_y0 = S_epd_v230->frame_y0;
+
+	/* if the beginning line of block is in active range of EPD */
+	if (S_epd_v230->block_y1 == S_epd_v230->block_size) stage_update.isLastBlock = 1;
+	stage_update.i=S_epd_v230->block_y0;
+}
+
+/**
+* \brief Start a frame of Block type waveform
+*/
+static void block_cycle_begin(void)
+{
+	struct EPD_V230_G2_Struct *S_epd_v230=&stage_update.S_epd_v230;
+	stage_update.isLastBlock = 0;
+	S_epd_v230->step_y0 = 0;
+	S_epd_v230->step_y1 = S_epd_v230->step_size ;
+	S_epd_v230->block_y0 = 0;
+	S_epd_v230->block_y1 = 0;
+	stage_update.m=0;
+	block_step_begin();
+}
+
+/**
+* \brief Write one line in range of block of Block type waveform
 *
-* \param EPD_type_index The defined EPD size
-* \param image_ptr The pointer of image array that stores image that will send to COG
-* \param image_data_address The address of memory that stores image
-* \param stage_no The assigned stage number that will proceed
-* \param lineoffset Line data offset
+* \return TRUE if all frames of Stage 1 or 3 are done
 */
-void stage_handle_Base(uint8_t EPD_type_index,uint8_t *image_prt,long image_data_address,
-						uint8_t stage_no,uint8_t lineoffset)
-{	
-	struct EPD_V230_G2_Struct S_epd_v230;
-	int16_t cycle,m,i; //m=number of steps
-	//uint8_t isLastframe = 0;	//If it is the last frame to send Nothing at the fist scan line
-	uint8_t isLastBlock=0;		//If the beginning line of block is in active range of EPD
-	int16_t scanline_no=0;
+static uint8_t block_line(void)
+{
+	uint8_t EPD_type_index=stage_update.EPD_type_index;
+	struct EPD_V230_G2_Struct *S_epd_v230=&stage_update.S_epd_v230;
+	int16_t i,scanline_no;
 	uint8_t *action_block_prt;
-	long action_block_address;
 	uint8_t byte_array[LINE_BUFFER_DATA_SIZE];
-	/** Stage 2: BLACK/WHITE image, Frame type */
-	if(stage_no==Stage2)
+
+	/* Move number of steps, then repeat number of frames */
+	while (stage_update.i >= S_epd_v230->block_y1 ||
+	       stage_update.i >= COG_parameters[EPD_type_index].vertical_size) {
+		if ((++stage_update.m) < S_epd_v230->number_of_steps) {
+			block_step_begin();
+		} else if ((++stage_update.cycle) < S_epd_v230->frame_cycle) {
+			block_cycle_begin();
+		} else return TRUE;
+	}
+	i=stage_update.i++;
+
+	if (stage_update.isLastBlock && (i < (S_epd_v230->step_size + S_epd_v230->block_y0)))
 	{
-		for(i=0;i<action__Waveform_param->stage2_cycle;i++)
+		nothing_line(EPD_type_index);
+	}
+	else
+	{
+		if(stage_update.image_prt!=NULL)
 		{
-			same_data_frame (EPD_type_index,ALL_BLACK,action__Waveform_param->stage2_t1);
-			same_data_frame (EPD_type_index,ALL_WHITE,action__Waveform_param->stage2_t2);
+			action_block_prt=stage_update.image_prt+(int)(i*stage_update.lineoffset);
 		}
+		else	//Read line data from flash
+		{
+			if(_On_EPD_read_flash!=NULL)
+				_On_EPD_read_flash(stage_update.image_data_address+(long)i*stage_update.lineoffset,
+				                   (uint8_t *)&byte_array,COG_parameters[EPD_type_index].horizontal_size);
+			action_block_prt=(uint8_t *)&byte_array;
+		}
+		read_line_data_handle(EPD_type_index,action_block_prt,stage_update.stage_no);
+	}
+
+	scanline_no= (COG_parameters[EPD_type_index].vertical_size-1)-i;
+
+	/* Scan byte shift per data line */
+	data_line_scan[(scanline_no>>2)] = SCAN_TABLE[(scanline_no%4)];
+
+	/*  the border uses the internal signal control byte. */
+	*data_line_border_byte=0x00;
+
+	/* Sending data */
+	epd_spi_send (0x0A, (uint8_t *)&COG_Line.uint8,
+	COG_parameters[EPD_type_index].data_line_size);
+
+	/* Turn on Output Enable */
+	epd_spi_send_byte (0x02, 0x07);
+
+	data_line_scan[(scanline_no>>2)]=0;
+	return FALSE;
+}
+
+/**
+* \brief Start the driving stage for Frame and Block type
+*/
+static void stage_begin(void)
+{
+	stage_update.cycle=0;
+	/** Stage 2: BLACK/WHITE image, Frame type */
+	if(stage_update.stage_no==Stage2)
+	{
+		same_data_begin();
 		return;
 	}
 	/** Stage 1 & 3, Block type */
 	// The frame/block/step of Stage1 and Stage3 are default the same.
-	stage_init(EPD_type_index,
-				&S_epd_v230,
+	stage_init(stage_update.EPD_type_index,
+				&stage_update.S_epd_v230,
 				action__Waveform_param->stage1_block1,
 				action__Waveform_param->stage1_step1,
 				action__Waveform_param->stage1_frame1);
-	 
-	 /* Repeat number of frames */
-   	 for (cycle = 0; cycle < (S_epd_v230.frame_cycle ); cycle++)
-   	 {
-		
-	    // if (cycle == (S_epd_v230.frame_cycle - 1)) isLastframe = 1;
-		 
-		 isLastBlock = 0;
-		 S_epd_v230.step_y0 = 0;
-		 S_epd_v230.step_y1 = S_epd_v230.step_size ;
-		 S_epd_v230.block_y0 = 0;
-		 S_epd_v230.block_y1 = 0;
-		 /* Move number of steps */
-	   	 for (m = 0; m < S_epd_v230.number_of_steps; m++)	 
-	   	 {		   	
-			 S_epd_v230.block_y1 += S_epd_v230.step_size;
-			 S_epd_v230.block_y0 = S_epd_v230.block_y1 - S_epd_v230.block_size;
-			/* reset block_y0=frame_y0 if block is not in active range of EPD */
-		   	 if (S_epd_v230.block_y0 < S_epd_v230.frame_y0) S_epd_v230.block_y0 = S_epd_v230.frame_y0;
-			
-			/* if the beginning line of block is in active range of EPD */
-			 if (S_epd_v230.block_y1 == S_epd_v230.block_size) isLastBlock = 1;
-			 	
-			 if(image_prt!=NULL)
-			 {
-				 action_block_prt=(image_prt+(int)(S_epd_v230.block_y0*lineoffset));	
-			 }
-			 else if(_On_EPD_read_flash!=NULL)	//Read line data in range of block, read first
-			 {
-				action_block_address=image_data_address+(long)(S_epd_v230.block_y0*lineoffset);
-				_On_EPD_read_flash(action_block_address,(uint8_t *)&byte_array,
-									COG_parameters[EPD_type_index].horizontal_size);
-				action_block_prt=(uint8_t *)&byte_array;
-			 }	
-			/* Update line data */
-		   	 for (i = S_epd_v230.block_y0; i < S_epd_v230.block_y1; i++)
-		   	 {		
-				
-			     if (i >= COG_parameters[EPD_type_index].vertical_size) break;
-				 //if (isLastframe && 
-				 if ( 
-				  isLastBlock &&(i < (S_epd_v230.step_size + S_epd_v230.block_y0)))
-				  {
-					  nothing_line(EPD_type_index);					
-				  }
-				  else	 
-				  {			  					 
-					  read_line_data_handle(EPD_type_index,action_block_prt,stage_no);					
-				  }
-			   		
-				if(_On_EPD_read_flash!=NULL)	//Read line data in range of block
-				{
-					action_block_address +=lineoffset;
-					_On_EPD_read_flash(action_block_address,(uint8_t *)&byte_array,
-					COG_parameters[EPD_type_index].horizontal_size);
-					action_block_prt=(uint8_t *)&byte_array;
-				}
-				else action_block_prt+=lineoffset;
-					
-				scanline_no= (COG_parameters[EPD_type_index].vertical_size-1)-i;
-					
-				/* Scan byte shift per data line */
-				data_line_scan[(scanline_no>>2)] = SCAN_TABLE[(scanline_no%4)];
-				   
-				/*  the border uses the internal signal control byte. */
-				*data_line_border_byte=0x00;
-					   
-				/* Sending data */
-				epd_spi_send (0x0A, (uint8_t *)&COG_Line.uint8,
-				COG_parameters[EPD_type_index].data_line_size);
-				
-					 
-				/* Turn on Output Enable */
-				epd_spi_send_byte (0x02, 0x07);
-					   
-				data_line_scan[(scanline_no>>2)]=0;		
-										
-		   	 }												
-	   	 }
-			
-    }	
+	block_cycle_begin();
 }
 
 /**
-* \brief The driving stages from image array (image_data.h) to COG
+* \brief Start the driving stages for Frame and Block type
+*
+* \note
+* - There are 3 stages to complete an image update on COG_V230_G2 type EPD.
+* - For more details on the driving stages, please refer to the COG G2 document Section 5.4
 *
 * \param EPD_type_index The defined EPD size
 * \param image_ptr The pointer of image array that stores image that will send to COG
-* \param stage_no The assigned stage number that will proceed
+* \param image_data_address The address of memory that stores image
+* \param first_stage The first stage number that will proceed
+* \param last_stage The last stage number that will proceed
 * \param lineoffset Line data offset
 */
-void stage_handle(uint8_t EPD_type_index,uint8_t *image_prt,uint8_t stage_no,uint8_t lineoffset)
+static void stage_update_begin(uint8_t EPD_type_index,uint8_t *image_prt,long image_data_address,
+						uint8_t first_stage,uint8_t last_stage,uint8_t lineoffset)
 {
-	stage_handle_Base(EPD_type_index,image_prt,ADDRESS_NULL,stage_no,lineoffset);	
+	stage_update.EPD_type_index=EPD_type_index;
+	stage_update.image_prt=image_prt;
+	stage_update.image_data_address=image_data_address;
+	stage_update.stage_no=first_stage;
+	stage_update.last_stage=last_stage;
+	stage_update.lineoffset=lineoffset;
+	stage_begin();
 }
 
 /**
-* \brief The driving stages from memory to COG
+* \brief Proceed the driving stages by EPD_LINES_PER_STEP lines
 *
-* \note
-* - This function is additional added here for developer if the image data
-*   is stored in Flash memory.
+* \note The Stage 2 frames repeat until the working time is fulfilled by
+*       checking the timer, so it never waits here.
+*
+* \return RES_BUSY if the update is in progress, or RES_OK when it is done
+*/
+uint8_t EPD_display_step (void)
+{
+	uint8_t n,is_done;
+	if(stage_update.stage_no>stage_update.last_stage) return RES_OK;
+	for(n=0; n<EPD_LINES_PER_STEP; n++)
+	{
+		if(stage_update.stage_no==Stage2) is_done=same_data_line();
+		else is_done=block_line();
+		if(!is_done) continue;
+		if((++stage_update.stage_no)>stage_update.last_stage) return RES_OK;
+		stage_begin();
+		break;
+	}
+	return RES_BUSY;
+}
+
+/**
+* \brief The driving stages from image array (image_data.h) to COG
 *
 * \param EPD_type_index The defined EPD size
-* \param image_data_address The address of flash memory that stores image
+* \param image_ptr The pointer of image array that stores image that will send to COG
 * \param stage_no The assigned stage number that will proceed
 * \param lineoffset Line data offset
 */
-static void stage_handle_ex(uint8_t EPD_type_index,long image_data_address,uint8_t stage_no,uint8_t lineoffset) {
-	stage_handle_Base(EPD_type_index,NULL,image_data_address,stage_no,lineoffset);
+void stage_handle(uint8_t EPD_type_index,uint8_t *image_prt,uint8_t stage_no,uint8_t lineoffset)
+{
+	stage_update_begin(EPD_type_index,image_prt,ADDRESS_NULL,stage_no,stage_no,lineoffset);
+	while(EPD_display_step()==RES_BUSY);
 }
 
 /**
@@ -696,16 +766,18 @@ void EPD_display_from_array_prt (uint8_t EPD_type_index, uint8_t *previous_image
 }
 
 /**
-* \brief Write image data from Flash memory to the EPD
-* \note This function is additional added here for developer if the image data
-* is stored in Flash.
+* \brief Start writing image data from Flash memory to the EPD
+* \note
+* - This function is additional added here for developer if the image data
+*   is stored in Flash.
+* - The update proceeds by calling EPD_display_step until it returns RES_OK.
 *
 * \param EPD_type_index The defined EPD size
 * \param previous_image_flash_address The start address of memory that stores previous image
 * \param new_image_flash_address The start address of memory that stores new image
 * \param On_EPD_read_flash Developer needs to create an external function to read flash
 */
-void EPD_display_from_flash_prt (uint8_t EPD_type_index, long previous_image_flash_address,
+void EPD_display_from_flash_begin (uint8_t EPD_type_index, long previous_image_flash_address,
     long new_image_flash_address,EPD_read_flash_handler On_EPD_read_flash) {
 		
 	uint8_t line_len;
@@ -713,9 +785,24 @@ void EPD_display_from_flash_prt (uint8_t EPD_type_index, long previous_image_fla
 	if(line_len==0) line_len=COG_parameters[EPD_type_index].horizontal_size;
 		
 	_On_EPD_read_flash=On_EPD_read_flash;	
-	stage_handle_ex(EPD_type_index,new_image_flash_address,Stage1,line_len);
-	stage_handle_ex(EPD_type_index,new_image_flash_address,Stage2,line_len);
-	stage_handle_ex(EPD_type_index,new_image_flash_address,Stage3,line_len);	
+	stage_update_begin(EPD_type_index,NULL,new_image_flash_address,Stage1,Stage3,line_len);
+}
+
+/**
+* \brief Write image data from Flash memory to the EPD
+* \note This function is additional added here for developer if the image data
+* is stored in Flash.
+*
+* \param EPD_type_index The defined EPD size
+* \param previous_image_flash_address The start address of memory that stores previous image
+* \param new_image_flash_address The start address of memory that stores new image
+* \param On_EPD_read_flash Developer needs to create an external function to read flash
+*/
+void EPD_display_from_flash_prt (uint8_t EPD_type_index, long previous_image_flash_address,
+    long new_image_flash_address,EPD_read_flash_handler On_EPD_read_flash) {
+	EPD_display_from_flash_begin(EPD_type_index,previous_image_flash_address,
+	                             new_image_flash_address,On_EPD_read_flash);
+	while(EPD_display_step()==RES_BUSY);
 }
 
 
@@ -792,55 +879,12 @@ static void border_dummy_line(uint8_t EPD_type_index)
 * \param EPD_type_index The defined EPD size
 */
 uint8_t EPD_power_off(uint8_t EPD_type_index) {
-	uint8_t y;		
-
 	if(EPD_type_index==EPD_144 || EPD_type_index==EPD_200) 	{
 		border_dummy_line(EPD_type_index);
 		dummy_line(EPD_type_index);
 	}
 
-	delay_ms (25);
-	if(EPD_type_index==EPD_270)	{
-		EPD_border_low();
-		delay_ms (200);
-		EPD_border_high();
-	}
-
-	//Check DC/DC
-	if((SPI_R(0x0F,0x00) & 0x40) == 0x00) return ERROR_DC;
-	
-	//Turn on Latch Reset
-	epd_spi_send_byte (0x03, 0x01);
-	//Turn off OE
-	epd_spi_send_byte (0x02, 0x05);
-	//Power off charge pump Vcom
-	epd_spi_send_byte (0x05, 0x0E);
-	//Power off charge pump neg voltage
-	epd_spi_send_byte (0x05, 0x02);
-	//Turn off all charge pump 
-	epd_spi_send_byte (0x05, 0x00);
-	//Turn off OSC
-	epd_spi_send_byte (0x07, 0x0D);
-	
-	epd_spi_send_byte (0x04, 0x83);
-	delay_ms(120);
-	epd_spi_send_byte (0x04, 0x00);
-	
-	epd_spi_detach ();
-	EPD_cs_low();
-	EPD_rst_low();
-	EPD_Vcc_turn_off ();
-	EPD_border_low();
-	delay_ms (10);
-		
-	for(y=0;y<10;y++)
-	{
-		EPD_discharge_high ();		
-		delay_ms (10);		
-		EPD_discharge_low ();	
-		delay_ms (10);	
-	}
-	return RES_OK;
+	return EPD_power_sequence_run(COG_power_off_sequence,EPD_type_index);
 }
 
 #endif
@@ -62,6 +62,14 @@
 #define ERROR_DC         (uint8_t)(0xF3)
 #define ERROR_CHARGEPUMP (uint8_t)(0xF4)
 #define RES_OK           (uint8_t)(0x00)
+#define RES_BUSY         (uint8_t)(0x01)
+
+/**
+ * \brief The number of lines written to COG in each step of updating EPD
+ * \note Less lines let main loop deal with UART more often while updating. */
+#ifndef EPD_LINES_PER_STEP
+#define EPD_LINES_PER_STEP 8
+#endif
 
 /**
  * \brief The COG Driver uses a buffer to update the EPD line by line.
@@ -82,6 +90,13 @@ enum Stage {
 };
 
 #if (defined COG_V110_G1)
+/**
+ * \brief The learned frame time is saved to flash if it drifts more than
+ *        1/2^N of the saved value, 3 is 12.5% */
+#ifndef FRAME_TIME_SAVE_DRIFT_SHIFT
+#define FRAME_TIME_SAVE_DRIFT_SHIFT 3
+#endif
+
 /** 
  * \brief Line data structure of 1.44 inch EPD
  * \note 
@@ -196,6 +211,7 @@ struct EPD_V230_G2_Struct
 	 int16_t step_y1;
 	 int16_t number_of_steps;
 };
+
 #else
 #error "ERROR: The EPD's COG type is not defined."
 #endif
@@ -232,7 +248,13 @@ void EPD_display_from_array_prt (uint8_t EPD_type_index, uint8_t *previous_image
 uint8_t *new_image_ptr);
 void EPD_display_from_flash_prt (uint8_t EPD_type_index, long previous_image_flash_address,
 	long new_image_flash_address,EPD_read_flash_handler On_EPD_read_flash);
+void EPD_display_from_flash_begin (uint8_t EPD_type_index, long previous_image_flash_address,
+	long new_image_flash_address,EPD_read_flash_handler On_EPD_read_flash);
+uint8_t EPD_display_step (void);
 uint8_t EPD_power_off (uint8_t EPD_type_index);
+#if (defined COG_V110_G1)
+uint8_t EPD_save_frame_time(void);
+#endif
 void COG_driver_EPDtype_select(uint8_t EPD_type_index);
 
 #endif 	//DISPLAY_COG_PROCESS__H_INCLUDED
@@ -33,6 +33,17 @@
 
 #include  "EPD_controller.h"
 
+static uint8_t display_EPD_type_index; /**< the EPD size which is updating */
+static uint8_t display_result;         /**< the result of updating EPD */
+static uint8_t display_is_busy;        /**< the EPD is updating */
+
+/** The power session keeps COG powered on between updates */
+static uint8_t session_is_open;
+static uint8_t session_EPD_type_index;
+static uint8_t session_result;         /**< the result of initializing COG driver */
+static uint32_t session_idle_ticks;    /**< the system ticks when COG becomes idle */
+static uint16_t session_idle_timeout=EPD_SESSION_IDLE_TIMEOUT;
+
 /**
  * \brief Initialize the EPD hardware setting 
  */
@@ -49,60 +60,111 @@ void EPD_display_init(void) {
  * \param EPD_type_index The defined EPD size
  * \param previous_image_ptr The pointer of memory that stores previous image
  * \param new_image_ptr The pointer of memory that stores new image
+ * \return RES_OK or the error code of COG driver
  */
-void EPD_display_from_pointer(uint8_t EPD_type_index,uint8_t *previous_image_ptr,
+uint8_t EPD_display_from_pointer(uint8_t EPD_type_index,uint8_t *previous_image_ptr,
 	uint8_t *new_image_ptr) {
-	/* Initialize EPD hardware */
-	EPD_init();
-	
-	/* Power on COG Driver */
-	EPD_power_on();
-	
-	/* Initialize COG Driver */
-	EPD_initialize_driver(EPD_type_index);
+	uint8_t result;
+	/* The image data is computed and streamed at full speed */
+	set_MCU_clock(MCU_CLOCK_RUN);
+	reset_SPI_bus_statistics();
+	/* Power on and initialize COG Driver unless power session is open */
+	if(session_is_open) result=EPD_session_open(EPD_type_index);
+	else result=EPD_power_init(EPD_type_index);
 	
 	/* Display image data on EPD from image array */
 	EPD_display_from_array_prt(EPD_type_index,previous_image_ptr,new_image_ptr);
 	
+	if(session_is_open) {
+		session_idle_ticks=get_system_ticks();
+		return result;
+	}
+	
 	/* Power off COG Driver */
-	EPD_power_off (EPD_type_index);
+	if(result==RES_OK) result=EPD_power_off (EPD_type_index);
+	else EPD_power_off (EPD_type_index);
+	return result;
 }
 
 /**
- * \brief Show image from Flash memory
+ * \brief Start showing image from Flash memory without waiting
+ *
+ * \note The update proceeds by calling EPD_display_poll until it doesn't
+ *       return RES_BUSY.
  *
  * \param EPD_type_index The defined EPD size
  * \param previous_image_address The address of memory that stores previous image
  * \param new_image_address The address of memory that stores new image
  * \param On_EPD_read_flash Developer needs to create an external function to read flash
  */
-void EPD_display_from_flash(uint8_t EPD_type_index,long previous_image_address,
-long new_image_address,EPD_read_flash_handler On_EPD_read_flash) {
-	/* Initialize EPD hardware */
-	EPD_init();
-	
-	/* Power on COG Driver */
-	EPD_power_on();
-	
-	/* Initialize COG Driver */
-	EPD_initialize_driver(EPD_type_index);
+void EPD_display_from_flash_start(uint8_t EPD_type_index,long previous_image_address,
+	long new_image_address,EPD_read_flash_handler On_EPD_read_flash) {
+	set_MCU_clock(MCU_CLOCK_RUN);
+	reset_SPI_bus_statistics();
+	/* Power on and initialize COG Driver unless power session is open */
+	if(session_is_open) display_result=EPD_session_open(EPD_type_index);
+	else display_result=EPD_power_init(EPD_type_index);
 	
-	/* Display image data on EPD from Flash memory */
-	EPD_display_from_flash_prt(EPD_type_index,previous_image_address,
+	/* Start displaying image data on EPD from Flash memory */
+	display_EPD_type_index=EPD_type_index;
+	display_is_busy=TRUE;
+	EPD_display_from_flash_begin(EPD_type_index,previous_image_address,
 	    new_image_address,On_EPD_read_flash);
+}
+
+/**
+ * \brief Proceed showing image which is started by EPD_display_from_flash_start
+ *        or EPD_display_from_flash_Ex_start
+ *
+ * \note The COG driver is powered off after the last stage unless power
+ *       session is open.
+ *
+ * \return RES_BUSY while updating, then RES_OK or the error code of COG driver
+ */
+uint8_t EPD_display_poll(void) {
+	if(!display_is_busy) return display_result;
+	set_MCU_clock(MCU_CLOCK_RUN);
+	if(EPD_display_step()==RES_BUSY) return RES_BUSY;
+	display_is_busy=FALSE;
+	if(session_is_open) {
+		session_idle_ticks=get_system_ticks();
+		return display_result;
+	}
 	
 	/* Power off COG Driver */
-	EPD_power_off (EPD_type_index);
+	if(display_result==RES_OK) display_result=EPD_power_off (display_EPD_type_index);
+	else EPD_power_off (display_EPD_type_index);
+	return display_result;
+}
+
+/**
+ * \brief Show image from Flash memory
+ *
+ * \param EPD_type_index The defined EPD size
+ * \param previous_image_address The address of memory that stores previous image
+ * \param new_image_address The address of memory that stores new image
+ * \param On_EPD_read_flash Developer needs to create an external function to read flash
+ * \return RES_OK or the error code of COG driver
+ */
+uint8_t EPD_display_from_flash(uint8_t EPD_type_index,long previous_image_address,
+long new_image_address,EPD_read_flash_handler On_EPD_read_flash) {
+	uint8_t result;
+	EPD_display_from_flash_start(EPD_type_index,previous_image_address,
+	    new_image_address,On_EPD_read_flash);
+	while((result=EPD_display_poll())==RES_BUSY);
+	return result;
 }
 /**
  * \brief Initialize the EPD hardware setting and COG driver
  *
  * \param EPD_type_index The defined EPD size 
+ * \return RES_OK or the error code of COG driver
  */
-void EPD_power_init(uint8_t EPD_type_index) {
+uint8_t EPD_power_init(uint8_t EPD_type_index) {
+	set_MCU_clock(MCU_CLOCK_RUN);
 	EPD_init();
 	EPD_power_on ();
-	EPD_initialize_driver (EPD_type_index);
+	return EPD_initialize_driver (EPD_type_index);
 }
 
 /**
@@ -117,16 +179,128 @@ void EPD_power_init(uint8_t EPD_type_index) {
  * \param previous_image_address The address of memory that stores previous image
  * \param new_image_address The address of memory that stores new image
  * \param On_EPD_read_flash Developer needs to create an external function to read flash
+ * \return RES_OK or the error code of power off
  */
-void EPD_display_from_flash_Ex(uint8_t EPD_type_index,long previous_image_address,
+uint8_t EPD_display_from_flash_Ex(uint8_t EPD_type_index,long previous_image_address,
 	long new_image_address,EPD_read_flash_handler On_EPD_read_flash) {
-
-	/* Display image data on EPD from Flash memory */
-	EPD_display_from_flash_prt(EPD_type_index,previous_image_address,
+	uint8_t result;
+	EPD_display_from_flash_Ex_start(EPD_type_index,previous_image_address,
 	    new_image_address,On_EPD_read_flash);
+	while((result=EPD_display_poll())==RES_BUSY);
+	return result;
+}
+
+/**
+ * \brief Start showing image from Flash memory without waiting when SPI is
+ *        common used with COG and Flash
+ *
+ * \note
+ * - Refer to EPD_display_from_flash_Ex, the COG must be powered on by
+ *   EPD_power_init.
+ * - The update proceeds by calling EPD_display_poll until it doesn't
+ *   return RES_BUSY.
+ *
+ * \param EPD_type_index The defined EPD size
+ * \param previous_image_address The address of memory that stores previous image
+ * \param new_image_address The address of memory that stores new image
+ * \param On_EPD_read_flash Developer needs to create an external function to read flash
+ */
+void EPD_display_from_flash_Ex_start(uint8_t EPD_type_index,long previous_image_address,
+	long new_image_address,EPD_read_flash_handler On_EPD_read_flash) {
+	set_MCU_clock(MCU_CLOCK_RUN);
+	reset_SPI_bus_statistics();
+	display_result=RES_OK;
+	display_EPD_type_index=EPD_type_index;
+	display_is_busy=TRUE;
 	
-	/* Power off COG Driver */
-	EPD_power_off (EPD_type_index);
+	/* Start displaying image data on EPD from Flash memory */
+	EPD_display_from_flash_begin(EPD_type_index,previous_image_address,
+	    new_image_address,On_EPD_read_flash);
+}
+
+/**
+ * \brief Open power session, the COG driver stays powered on for any number
+ *        of updates until the session is closed
+ *
+ * \note
+ * - The updates in session skip powering on and off COG driver, so the
+ *   updates back to back pay them once.
+ * - It does nothing if the session of the same EPD size is open, or closes
+ *   the session of the other EPD size first.
+ * - The session is closed by EPD_session_close, or by EPD_session_poll after
+ *   COG driver is idle for the idle timeout.
+ *
+ * \param EPD_type_index The defined EPD size
+ * \return RES_OK or the error code of COG driver
+ */
+uint8_t EPD_session_open(uint8_t EPD_type_index) {
+	if(session_is_open) {
+		if(session_EPD_type_index==EPD_type_index) {
+			session_idle_ticks=get_system_ticks();
+			return session_result;
+		}
+		EPD_session_close();
+	}
+	session_result=EPD_power_init(EPD_type_index);
+	session_EPD_type_index=EPD_type_index;
+	session_idle_ticks=get_system_ticks();
+	session_is_open=TRUE;
+	return session_result;
 }
 
+/**
+ * \brief Close power session and power off COG driver
+ *
+ * \return RES_OK or the error code of power off
+ */
+uint8_t EPD_session_close(void) {
+	if(!session_is_open) return RES_OK;
+	session_is_open=FALSE;
+	/* It may be called by a timer task at MCU_CLOCK_WAIT */
+	set_MCU_clock(MCU_CLOCK_RUN);
+	return EPD_power_off(session_EPD_type_index);
+}
 
+/**
+ * \brief Check the power session is open
+ *
+ * \return TRUE if the COG driver is kept powered on
+ */
+uint8_t EPD_session_is_open(void) {
+	return session_is_open;
+}
+
+/**
+ * \brief Restart the idle time of power session
+ *
+ * \note The work for the next update, e.g. loading image, calls it to keep
+ *       COG driver powered on until the update.
+ */
+void EPD_session_touch(void) {
+	session_idle_ticks=get_system_ticks();
+}
+
+/**
+ * \brief Set the idle time to close power session automatically
+ *
+ * \param timeout The idle time in mSec
+ */
+void EPD_session_set_idle_timeout(uint16_t timeout) {
+	session_idle_timeout=timeout;
+}
+
+/**
+ * \brief Close power session if COG driver is idle for the idle timeout
+ *
+ * \note It is called periodically by main loop. The system ticks wrap
+ *       around every 35 minutes which is far more than the idle timeout.
+ *
+ * \return TRUE if the session has been closed by this call
+ */
+uint8_t EPD_session_poll(void) {
+	if(!session_is_open || display_is_busy) return FALSE;
+	if((get_system_ticks()-session_idle_ticks)<
+	   ((uint32_t)session_idle_timeout*SYSTEM_TICKS_PER_MS)) return FALSE;
+	EPD_session_close();
+	return TRUE;
+}
@@ -33,13 +33,30 @@
 #define 	DISPLAY_CONTROLLER_H_INCLUDED
 #include	"Pervasive_Displays_small_EPD.h"
 
+/**
+ * \brief The default idle time in mSec to close power session automatically */
+#ifndef EPD_SESSION_IDLE_TIMEOUT
+#define EPD_SESSION_IDLE_TIMEOUT 1000
+#endif
+
 void EPD_display_init(void);
-void EPD_power_init(uint8_t EPD_type_index);
-void EPD_display_from_pointer(uint8_t EPD_type_index,uint8_t *previous_image_ptr,
+uint8_t EPD_power_init(uint8_t EPD_type_index);
+uint8_t EPD_display_from_pointer(uint8_t EPD_type_index,uint8_t *previous_image_ptr,
 	uint8_t *new_image_ptr);
-void EPD_display_from_flash(uint8_t EPD_type_index,long previous_image_address,
+uint8_t EPD_display_from_flash(uint8_t EPD_type_index,long previous_image_address,
+	long new_image_address,EPD_read_flash_handler On_EPD_read_flash);
+uint8_t EPD_display_from_flash_Ex(uint8_t EPD_type_index,long previous_image_address,
+	long new_image_address,EPD_read_flash_handler On_EPD_read_flash);
+void EPD_display_from_flash_start(uint8_t EPD_type_index,long previous_image_address,
 	long new_image_address,EPD_read_flash_handler On_EPD_read_flash);
-void EPD_display_from_flash_Ex(uint8_t EPD_type_index,long previous_image_address,
+void EPD_display_from_flash_Ex_start(uint8_t EPD_type_index,long previous_image_address,
 	long new_image_address,EPD_read_flash_handler On_EPD_read_flash);
+uint8_t EPD_display_poll(void);
+uint8_t EPD_session_open(uint8_t EPD_type_index);
+uint8_t EPD_session_close(void);
+uint8_t EPD_session_is_open(void);
+void EPD_session_touch(void);
+void EPD_session_set_idle_timeout(uint16_t timeout);
+uint8_t EPD_session_poll(void);
 
 #endif 	//DISPLAY_CONTROLLER_H_INCLUDED
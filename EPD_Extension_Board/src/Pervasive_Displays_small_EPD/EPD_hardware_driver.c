@@ -31,65 +31,161 @@
  *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include <math.h>
 #include "EPD_hardware_driver.h"
 
-static  uint16_t EPD_Counter;
+/** The system ticks as EPD timer starts, EPD timer counts mSec from it */
+static uint32_t EPD_timer_start_ticks;
+/** The mSec count of EPD timer as it is stopped */
+static uint32_t EPD_timer_stop_count;
+static uint8_t  EPD_timer_is_running;
+/** The high bits of system ticks, counts the overflow of Timer0_A */
+static volatile uint32_t system_ticks_high;
 static uint8_t spi_flag = FALSE;
+static uint8_t hardware_is_initialized = FALSE;
+#if SPI_BUS_STATISTICS
+static SPI_bus_statistics_t SPI_bus_statistics;
+#define SPI_BUS_COUNT(name)	(SPI_bus_statistics.name++)
+#else
+#define SPI_BUS_COUNT(name)
+#endif
+static EPD_timer_event_handler _On_EPD_timer_event;
+#if MCU_CLOCK_SCALING
+/** Timer0_A counts SMCLK/8 at MCU_CLOCK_RUN, and SMCLK at MCU_CLOCK_WAIT which
+ *  is 2 system ticks per count. The system ticks keep 2 ticks per uSec. */
+static uint8_t system_ticks_shift;
+static uint8_t current_MCU_clock=MCU_CLOCK_RUN;
+#if MCU_CLOCK_STATISTICS
+static uint32_t MCU_clock_start_ticks; /**< the system ticks as MCU clock switched */
+static MCU_clock_statistics_t MCU_clock_statistics;
+#endif
+static MCU_clock_event_handler _On_MCU_clock_event;
+#else
+#define system_ticks_shift 0
+#endif
+
+static void sample_temperature(void);
+static uint8_t get_spi_divider(void);
 
 /**
- * \brief Set up EPD Timer for 1 mSec interrupts
+ * \brief Set up Timer0_A as free running system time base
  *
  * \note
- * desired value: 1mSec
- * actual value:  1.000mSec
+ * - Timer0_A counts SMCLK/8 in continuous mode and never stops, the
+ *   overflow interrupt extends it to 32-bit system ticks.
+ * - CCR1 compare interrupt is armed by delay only to wake up the CPU.
+ * - It does nothing if the timer is running already.
  */
 static void initialize_EPD_timer(void) {
-	//------------------Timer A1----------------------------------------
-	//set up Timer_A CCR1 as master timer using ACLK	
-	TA0CCTL2 &= ~(CCIFG | CCIE); // reset CCIFG Interrupt Flag
-	TA0CTL = TASSEL_2 + MC_0 + TACLR + ID_3;
-	TA0CCTL2 = OUTMOD_4;
-	EPD_Counter = 0;
+	if(TA0CTL & MC_2) return;
+	TA0CCTL1 = 0;
+	TA0CTL = TASSEL_2 + MC_2 + TACLR + (system_ticks_shift ? ID_0 : ID_3) + TAIE;
+	system_ticks_high = 0;
 }
 
 /**
  * \brief Start Timer
+ *
+ * \note EPD timer is tickless, it reads the system time base instead of
+ *       counting 1mSec interrupts.
  */
 void start_EPD_timer(void) {
 	initialize_EPD_timer();
-	TA0R = 0;
-	TA0CCR0 = 990 * 2; // 1ms
-	TA0CCTL2 |= CCIE;
-	TA0CTL |= MC_1;
-	EPD_Counter = 0;
+	EPD_timer_start_ticks = get_system_ticks();
+	EPD_timer_is_running = TRUE;
 }
 
 /**
  * \brief Stop Timer
  */
 void stop_EPD_timer(void) {
-	TA0CCTL2 &= ~CCIE;
-	TA0CTL &= ~MC_1;
+	EPD_timer_stop_count = get_current_time_tick();
+	EPD_timer_is_running = FALSE;
+}
+
+/**
+ * \brief Read the 48-bit system time base
+ *
+ * \note An overflow which is not handled yet (interrupt disabled) is added,
+ *       so the time never goes backwards.
+ *
+ * \param low The low 16 bits of system ticks
+ * \return The high bits of system ticks
+ */
+static uint32_t read_system_time(uint16_t *low) {
+	uint32_t high,ticks;
+	uint16_t count;
+	do {
+		high = system_ticks_high;
+		count = TA0R;
+	} while (high != system_ticks_high);
+	if ((TA0CTL & TAIFG) && count < 0x8000) high += 1 << system_ticks_shift;
+	ticks = (uint32_t)count << system_ticks_shift;
+	*low = (uint16_t)ticks;
+	return high + (ticks >> 16);
+}
+
+/**
+ * \brief Get system ticks of SMCLK/8 since power on
+ *
+ * \note It is wrapped around every 35 minutes at 16MHz, use the difference
+ *       of two ticks for the time between them.
+ */
+uint32_t get_system_ticks(void) {
+	uint16_t low;
+	uint32_t high = read_system_time(&low);
+	return (high << 16) | low;
+}
+
+/**
+ * \brief Get the monotonic time in uSec since power on
+ *
+ * \note It is wrapped around every 71 minutes.
+ */
+uint32_t get_system_us(void) {
+	uint16_t low;
+	uint32_t high = read_system_time(&low);
+	return (high << 15) | (low >> 1);
+}
+
+/**
+ * \brief Get the monotonic time in mSec since power on
+ *
+ * \note
+ * - It is wrapped around every 49 days, use it for long intervals.
+ * - 125 overflows are 4096mSec exactly, so the result has no drift.
+ */
+uint32_t get_system_ms(void) {
+	uint16_t low;
+	uint32_t high = read_system_time(&low);
+	return (high / 125) * 4096 + (((high % 125) << 16) + low) / SYSTEM_TICKS_PER_MS;
 }
 
 /**
  * \brief Get current Timer after starting a new one
  */
 uint32_t get_current_time_tick(void) {
-	return EPD_Counter;
+	if(!EPD_timer_is_running) return EPD_timer_stop_count;
+	return (get_system_ticks() - EPD_timer_start_ticks) / SYSTEM_TICKS_PER_MS;
 }
 /**
  * \brief Set current Timer after starting a new one
  */
 void set_current_time_tick(uint32_t count) {
-     EPD_Counter=count;
+	EPD_timer_start_ticks = get_system_ticks() - count * SYSTEM_TICKS_PER_MS;
+	EPD_timer_stop_count = count;
 }
 /**
- * \brief Interrupt Service Routine for system tick counter
+ * \brief Set the function called by every overflow of system time base
+ *
+ * \note
+ * - It is called in interrupt, so it must be short.
+ * - It is called every 32.768mSec whether EPD timer is running or not, and
+ *   every 65.536mSec at MCU_CLOCK_WAIT.
+ *
+ * \param On_EPD_timer_event The function, NULL for none
  */
-void SysTick_Handler(void) {
-	EPD_Counter++;
+void set_EPD_timer_event(EPD_timer_event_handler On_EPD_timer_event) {
+	_On_EPD_timer_event=On_EPD_timer_event;
 }
 
 /**
@@ -99,25 +195,245 @@ void SysTick_Handler(void) {
 __interrupt void Timer_A0(void) {
 	switch (__even_in_range(TA0IV, 10)) {
 	case 2:
-		//LPM3_EXIT;
+		TA0CCTL1 &= ~CCIE; // one-shot wake up of delay
+		LPM3_EXIT;
 		break;
 
-	case 4:
-		EPD_Counter++;
+	case 10:
+		system_ticks_high += 1 << system_ticks_shift;
+		sample_temperature();
+		if(_On_EPD_timer_event!=NULL) _On_EPD_timer_event();
 		LPM3_EXIT;
 		break;
 	}
 
 }
 
+//******************************************************************
+//* MCU clock Configuration
+//******************************************************************
+
+/**
+ * \brief Set CPU work Frequency
+ *
+ * \param select_index The defined CPU frequency
+ * */
+void set_MCU_frequency(uint8_t select_index) {
+
+	switch (select_index) {
+	case DCO_1MHz:
+		if (CALBC1_1MHZ == 0xFF || CALDCO_1MHZ == 0xFF) {
+			while (1)
+				; // If calibration constants erased, do not load, trap CPU.
+		}
+		BCSCTL1 = CALBC1_1MHZ; // Set range
+		DCOCTL = CALDCO_1MHZ; // Set DCO step + modulation */
+		break;
+	case DCO_8MHz:
+		if (CALBC1_8MHZ == 0xFF || CALDCO_8MHZ == 0xFF) {
+			while (1)
+				;
+		}
+		BCSCTL1 = CALBC1_8MHZ;
+		DCOCTL = CALDCO_8MHZ;
+		break;
+	case DCO_12MHz:
+		if (CALBC1_12MHZ == 0xFF || CALDCO_12MHZ == 0xFF) {
+			while (1)
+				;
+		}
+		BCSCTL1 = CALBC1_12MHZ;
+		DCOCTL = CALDCO_12MHZ;
+		break;
+	case DCO_16MHz:
+		if (CALBC1_16MHZ == 0xFF || CALDCO_16MHZ == 0xFF) {
+			//Info is missing, guess at a good value.
+			BCSCTL1 = 0x8f; //CALBC1_16MHZ at 0x10f9
+			DCOCTL = 0x9C;  //CALDCO_16MHZ at 0x10f8
+		} else {
+			BCSCTL1 = CALBC1_16MHZ;
+			DCOCTL = CALDCO_16MHZ;
+		}
+		break;
+	}
+}
+
+#if MCU_CLOCK_SCALING
+/**
+ * \brief Rescale the count of Timer0_A as its clock changes
+ *
+ * \note The timer stops while its count is moved to the new scale, so the
+ *       system ticks go on without a gap. It is called with interrupt disabled.
+ *
+ * \param shift 0=SMCLK/8 at MCU_CLOCK_RUN, 1=SMCLK at MCU_CLOCK_WAIT
+ */
+static void set_system_ticks_shift(uint8_t shift) {
+	uint32_t ticks;
+	if (!(TA0CTL & MC_3)) {
+		system_ticks_shift = shift;
+		return;
+	}
+	TA0CTL &= ~MC_3;
+	if (TA0CTL & TAIFG) {
+		/* The overflow is counted here instead of interrupt */
+		system_ticks_high += 1 << system_ticks_shift;
+		TA0CTL &= ~TAIFG;
+	}
+	ticks = (uint32_t)TA0R << system_ticks_shift;
+	system_ticks_high += ticks >> 16;
+	TA0R = (uint16_t)ticks >> shift;
+	system_ticks_shift = shift;
+	TA0CTL = TASSEL_2 + MC_2 + (shift ? ID_0 : ID_3) + TAIE;
+}
+
+#if MCU_CLOCK_STATISTICS
+/**
+ * \brief Add the time since the last update to the current MCU clock
+ */
+static void update_MCU_clock_time(void) {
+	uint32_t ms = (get_system_ticks() - MCU_clock_start_ticks) / SYSTEM_TICKS_PER_MS;
+	MCU_clock_statistics.time[current_MCU_clock] += ms;
+	MCU_clock_start_ticks += ms * SYSTEM_TICKS_PER_MS;
+}
+#endif
+
+/**
+ * \brief Switch MCU clock, the peripherals clocked by SMCLK follow it
+ *
+ * \note
+ * - MCU_CLOCK_WAIT is refused while PWM (Timer1_A) is running or the
+ *   function set by set_MCU_clock_event refuses it.
+ * - MCU_CLOCK_RUN is never refused, the function waits for a few mSec at
+ *   most, e.g. the UART until the bytes in flight are done, so the delays of
+ *   COG sequences stay in time while the host keeps sending.
+ * - The system ticks, delays and SPI are set for the new clock here, the
+ *   UART is set by the function of set_MCU_clock_event. The function is
+ *   called right after the DCO changes, the statistics follow it if
+ *   MCU_CLOCK_STATISTICS is set.
+ *
+ * \param MCU_clock MCU_CLOCK_RUN or MCU_CLOCK_WAIT
+ * \return TRUE if the MCU runs at the clock
+ */
+uint8_t set_MCU_clock(uint8_t MCU_clock) {
+	unsigned short state;
+	if (MCU_clock == current_MCU_clock) return TRUE;
+	if (MCU_clock == MCU_CLOCK_WAIT && (TA1CTL & MC_3)) return FALSE;
+	state = __get_interrupt_state();
+	__disable_interrupt();
+	if (_On_MCU_clock_event != NULL && !_On_MCU_clock_event(MCU_clock, FALSE) &&
+	    MCU_clock == MCU_CLOCK_WAIT) {
+		__set_interrupt_state(state);
+		return FALSE;
+	}
+
+	if (MCU_clock == MCU_CLOCK_RUN) {
+		set_MCU_frequency(DCO_16MHz);
+		set_system_ticks_shift(0);
+	} else {
+		set_system_ticks_shift(1);
+		set_MCU_frequency(DCO_1MHz);
+	}
+	if (_On_MCU_clock_event != NULL) _On_MCU_clock_event(MCU_clock, TRUE);
+#if MCU_CLOCK_STATISTICS
+	update_MCU_clock_time();
+	MCU_clock_statistics.switches++;
+#endif
+	current_MCU_clock = MCU_clock;
+	if (spi_flag) {
+		BITSET(SPICTL1, UCSWRST);
+		SPIBR0 = get_spi_divider();
+		BITCLR(SPICTL1, UCSWRST);
+	}
+	__set_interrupt_state(state);
+	return TRUE;
+}
+
+#if MCU_CLOCK_STATISTICS
+/**
+ * \brief Get the time spent at each MCU clock
+ */
+const MCU_clock_statistics_t *get_MCU_clock_statistics(void) {
+	update_MCU_clock_time();
+	return &MCU_clock_statistics;
+}
+#endif
+#else
+uint8_t set_MCU_clock(uint8_t MCU_clock) {
+	return (MCU_clock == MCU_CLOCK_RUN);
+}
+#endif
+
+/**
+ * \brief Get the current MCU clock, MCU_CLOCK_RUN or MCU_CLOCK_WAIT
+ */
+uint8_t get_MCU_clock(void) {
+#if MCU_CLOCK_SCALING
+	return current_MCU_clock;
+#else
+	return MCU_CLOCK_RUN;
+#endif
+}
+
+/**
+ * \brief Set the function called as MCU clock switches
+ *
+ * \param On_MCU_clock_event The function, NULL for none
+ */
+void set_MCU_clock_event(MCU_clock_event_handler On_MCU_clock_event) {
+#if MCU_CLOCK_SCALING
+	_On_MCU_clock_event=On_MCU_clock_event;
+#endif
+}
+
+/**
+ * \brief Sleep in LPM0 until system ticks reach the end
+ *
+ * \note
+ * - CCR1 is armed as one-shot if the end is in 0x7F00 ticks, otherwise the
+ *   overflow interrupt wakes up the CPU to check again.
+ * - LPM0 keeps SMCLK on for Timer0_A, UART and PWM.
+ * - Other interrupts may wake up the CPU earlier, it goes back to sleep.
+ * - The MCU sleeps at MCU_CLOCK_WAIT if the time is long enough, then the
+ *   clock is restored.
+ *
+ * \param end_ticks The system ticks to wake up
+ */
+static void sleep_until(uint32_t end_ticks) {
+	unsigned short state = __get_interrupt_state();
+	int32_t remain;
+#if MCU_CLOCK_SCALING
+	uint8_t clock = current_MCU_clock;
+#endif
+	initialize_EPD_timer();
+	__disable_interrupt();
+#if MCU_CLOCK_SCALING
+	if ((int32_t)(end_ticks - get_system_ticks()) >=
+	    (int32_t)MCU_CLOCK_WAIT_MIN_MS * SYSTEM_TICKS_PER_MS) set_MCU_clock(MCU_CLOCK_WAIT);
+#endif
+	while ((remain = (int32_t)(end_ticks - get_system_ticks())) > 0) {
+		if (remain < 0x7F00) {
+			/* The compare is one count late at most, it is checked again
+			   in case the timer has passed it already */
+			TA0CCR1 = TA0R + (uint16_t)(remain >> system_ticks_shift) + 1;
+			TA0CCTL1 = CCIE;
+			if ((int16_t)(TA0CCR1 - TA0R) <= 0) continue;
+		}
+		__bis_SR_register(LPM0_bits + GIE);
+		__disable_interrupt();
+	}
+	TA0CCTL1 = 0;
+	__set_interrupt_state(state);
+#if MCU_CLOCK_SCALING
+	set_MCU_clock(clock);
+#endif
+}
+
 /**
  * \brief Delay mini-seconds
  * \param ms The number of mini-seconds
  */
 void delay_ms(unsigned int ms) {
-	while (ms--) {
-		__delay_cycles(SMCLK_FREQ / 1000);
-	}
+	sleep_until(get_system_ticks() + (uint32_t)ms * SYSTEM_TICKS_PER_MS);
 }
 
 /**
@@ -136,40 +452,83 @@ static void Wait_10us(void) {
 //* PWM  Configuration/Control //PWM output : PD3
 //******************************************************************
 
+#if (defined COG_V110_G1) && UART_RX_ISR_PROFILE
+#error "ERROR: Timer1_A is used by PWM of G1 COG, disable UART_RX_ISR_PROFILE."
+#endif
+
 /**
  * \brief The PWM signal starts toggling
+ *
+ * \note Timer1_A counts SMCLK in up mode, CCR1 toggles P2.1(TA1.1) in
+ *       reset/set mode with 50% duty, no CPU is needed.
  */
 void PWM_start_toggle(void) {
-
+	set_MCU_clock(MCU_CLOCK_RUN);
+	TA1CTL = TACLR;
+	TA1CCR0 = PWM_PERIOD_TICKS - 1;
+	TA1CCR1 = PWM_PERIOD_TICKS / 2;
+	TA1CCTL1 = OUTMOD_7;
+	BITSET(P2SEL, PWM_PIN);
+	BITCLR(P2SEL2, PWM_PIN);
+	TA1CTL = TASSEL_2 + MC_1;
 }
 
 /**
  * \brief The PWM signal stops toggling.
  */
 void PWM_stop_toggle(void) {
-
+	TA1CTL = MC_0;
+	TA1CCTL1 = OUTMOD_0;
+	BITCLR(P2SEL, PWM_PIN);
+	EPD_pwm_low();
 }
 
 /**
  * \brief PWM toggling.
  *
+ * \note The CPU sleeps in LPM0 while Timer1_A outputs PWM.
+ *
  * \param ms The interval of PWM toggling (mini seconds)
  */
 void PWM_run(uint16_t ms) {
-	start_EPD_timer();
-	do {
-		EPD_pwm_high();
-		__delay_cycles(30);
-		EPD_pwm_low();
-		__delay_cycles(30);
-	} while (get_current_time_tick() < ms); //wait Delay Time
-	stop_EPD_timer();
+	PWM_start_toggle();
+	delay_ms(ms);
+	PWM_stop_toggle();
 }
 
 //******************************************************************
 //* SPI  Configuration
 //******************************************************************
 
+/**
+ * \brief Get the SPI clock divider of the current MCU clock
+ *
+ * \note The COG and Flash share COG_SPI_baudrate, the divider changes with
+ *       MCU clock only.
+ */
+static uint8_t get_spi_divider(void) {
+	if (get_MCU_clock() != MCU_CLOCK_RUN) return 1; // 1MHz at MCU_CLOCK_WAIT
+	return SPI_baudrate;
+}
+
+/**
+ * \brief Clear the transitions of SPI bus, it is called as an update starts
+ */
+void reset_SPI_bus_statistics(void) {
+#if SPI_BUS_STATISTICS
+	memset(&SPI_bus_statistics, 0, sizeof(SPI_bus_statistics));
+#endif
+}
+
+#if SPI_BUS_STATISTICS
+/**
+ * \brief Get the transitions of SPI bus since the last update started
+ */
+const SPI_bus_statistics_t *get_SPI_bus_statistics(void) {
+	return &SPI_bus_statistics;
+}
+#endif
+
 /**
  * \brief Configure SPI
  */
@@ -187,7 +546,7 @@ void epd_spi_init(void) {
 	//comfig SPI
 	SPICTL0 = UCCKPH | UCMST | UCSYNC | UCMSB;
 	SPICTL1 = UCSSEL_2 + UCSWRST;
-	SPIBR0 = 2; //16MHz/2=8MHz
+	SPIBR0 = get_spi_divider(); //16MHz/2=8MHz for COG and Flash by default
 	SPIBR1 = 0;
 
 	BITSET(REN (SPIMISO_PORT), SPIMISO_PIN);
@@ -196,8 +555,16 @@ void epd_spi_init(void) {
 
 /**
  * \brief Initialize SPI
+ *
+ * \note It does nothing if SPI is attached and neither chip is selected.
  */
 void epd_spi_attach(void) {
+	SPI_BUS_COUNT(attaches);
+	if (spi_flag && (OUTPORT(EPD_CS_PORT) & EPD_CS_PIN) &&
+	    (OUTPORT(Flash_CS_PORT) & Flash_CS_PIN)) {
+		SPI_BUS_COUNT(attach_skipped);
+		return;
+	}
 	EPD_flash_cs_high();
 	EPD_cs_high();
 	epd_spi_init();
@@ -255,6 +622,197 @@ uint8_t epd_spi_write_ex(unsigned char Data) {
 	return flag;
 }
 
+/** Write one byte as soon as the previous one moves to the shift register */
+#define SPI_PUT(data)	do { \
+		while (!(SPIIFG & SPITXIFG)) \
+			; \
+		SPITXBUF = (data); \
+	} while (0)
+
+/** Wait the byte is shifted in, then read it and start the next byte at once.
+ * \note RXBUF is read before TXBUF is written, a byte can't be overrun even
+ *       if an interrupt comes between them. */
+#define SPI_SWAP(rx, tx)	do { \
+		uint8_t _b; \
+		while (!(SPIIFG & SPIRXIFG)) \
+			; \
+		_b = SPIRXBUF; \
+		SPITXBUF = (tx); \
+		(rx) = _b; \
+	} while (0)
+
+/**
+ * \brief Send a block of data to SPI
+ *
+ * \note
+ * - The TX buffer is refilled as soon as it is empty, the SPI clock runs
+ *   without gaps between bytes. The loop is unrolled by 4 bytes.
+ * - It returns after the last bit is shifted out, so chip select can be
+ *   released at once.
+ *
+ * \param data The data to be sent out
+ * \param length The number of bytes
+ */
+void epd_spi_write_block(const uint8_t *data, uint16_t length) {
+	register const uint8_t *p = data;
+	register uint16_t n = length >> 2;
+
+	while (n--) {
+		SPI_PUT(p[0]);
+		SPI_PUT(p[1]);
+		SPI_PUT(p[2]);
+		SPI_PUT(p[3]);
+		p += 4;
+	}
+	n = length & 3;
+	while (n--)
+		SPI_PUT(*p++);
+	while (SPISTAT & UCBUSY)
+		;
+}
+
+/**
+ * \brief Read a block of data from SPI by sending dummy bytes
+ *
+ * \note Each byte is started as soon as the previous one is read out of RX
+ *       buffer. The loop is unrolled by 2 bytes.
+ *
+ * \param data The buffer to store the data
+ * \param length The number of bytes
+ * \param dummy The byte to be sent out while reading
+ */
+void epd_spi_read_block(uint8_t *data, uint16_t length, uint8_t dummy) {
+	register uint8_t *p = data;
+	register uint16_t n;
+
+	if (length == 0)
+		return;
+	while (SPISTAT & UCBUSY)
+		;
+	(void)SPIRXBUF; // discard the byte received by the previous write
+	SPITXBUF = dummy;
+	n = (length - 1) >> 1;
+	while (n--) {
+		SPI_SWAP(p[0], dummy);
+		SPI_SWAP(p[1], dummy);
+		p += 2;
+	}
+	if (!(length & 1))
+		SPI_SWAP(*p++, dummy);
+	while (!(SPIIFG & SPIRXIFG))
+		;
+	*p = SPIRXBUF;
+}
+
+/**
+ * \brief Send a block of data to SPI and read the data shifted in at the
+ *        same time
+ *
+ * \note The buffers of sending and reading can be the same one.
+ *
+ * \param tx_data The data to be sent out
+ * \param rx_data The buffer to store the data
+ * \param length The number of bytes
+ */
+void epd_spi_exchange_block(const uint8_t *tx_data, uint8_t *rx_data, uint16_t length) {
+	register const uint8_t *tx = tx_data;
+	register uint8_t *rx = rx_data;
+	register uint16_t n;
+
+	if (length == 0)
+		return;
+	while (SPISTAT & UCBUSY)
+		;
+	(void)SPIRXBUF; // discard the byte received by the previous write
+	SPITXBUF = *tx++;
+	n = (length - 1) >> 1;
+	while (n--) {
+		SPI_SWAP(rx[0], tx[0]);
+		SPI_SWAP(rx[1], tx[1]);
+		tx += 2;
+		rx += 2;
+	}
+	if (!(length & 1))
+		SPI_SWAP(*rx++, *tx);
+	while (!(SPIIFG & SPIRXIFG))
+		;
+	*rx = SPIRXBUF;
+}
+
+#if SPI_BENCHMARK
+/** The bytes of each benchmark case, COG lines and the last one is Flash burst.
+ *  No chip is selected while measuring. */
+static const uint16_t SPI_benchmark_length[SPI_BENCHMARK_CASES] = {
+	16, 57, 111, 4096
+};
+
+/**
+ * \brief Convert the bytes transferred in system ticks to bytes/s
+ */
+static uint32_t bytes_per_second(uint16_t bytes, uint32_t ticks) {
+	if (ticks == 0)
+		ticks = 1;
+	/* 2000000 ticks/s is split so bytes*125000 fits 32 bits */
+	return (((uint32_t)bytes * (SYSTEM_TICKS_PER_MS * 1000 / 16)) / ticks) * 16;
+}
+
+/**
+ * \brief Measure the throughput of sending a COG line or reading a Flash burst
+ *
+ * \note
+ * - The COG lines are sent by epd_spi_send's way, the Flash burst is read by
+ *   flash_cmd_read's way, once by the transfer of each byte and once by the
+ *   block transfer. The COG lines are repeated SPI_BENCHMARK_REPEAT times.
+ * - Both chip selects are high, so the COG and Flash ignore the transfer. It
+ *   can't run while updating EPD.
+ *
+ * \param index The benchmark case, 0 to SPI_BENCHMARK_CASES-1
+ * \param result The throughput of the case
+ * \return FALSE if the case doesn't exist
+ */
+uint8_t epd_spi_benchmark(uint8_t index, SPI_benchmark_t *result) {
+	const uint8_t *source = (const uint8_t *)INFO_FLASH_ADDRESS;
+	uint8_t buffer[SPI_BENCHMARK_CHUNK];
+	uint16_t length, i, n;
+	uint32_t ticks;
+
+	if (index >= SPI_BENCHMARK_CASES)
+		return FALSE;
+	length = SPI_benchmark_length[index];
+	set_MCU_clock(MCU_CLOCK_RUN);
+	epd_spi_attach();
+	result->length = length;
+	result->theoretical = (SMCLK_FREQ / 8) / get_spi_divider();
+
+	if (index < SPI_BENCHMARK_CASES - 1) {
+		ticks = get_system_ticks();
+		for (n = 0; n < SPI_BENCHMARK_REPEAT; n++) {
+			for (i = 0; i < length; i++)
+				epd_spi_write(source[i]);
+		}
+		while (SPISTAT & UCBUSY)
+			;
+		result->byte_loop = bytes_per_second(length * SPI_BENCHMARK_REPEAT,
+		                                     get_system_ticks() - ticks);
+		ticks = get_system_ticks();
+		for (n = 0; n < SPI_BENCHMARK_REPEAT; n++)
+			epd_spi_write_block(source, length);
+		result->block = bytes_per_second(length * SPI_BENCHMARK_REPEAT,
+		                                 get_system_ticks() - ticks);
+	} else {
+		ticks = get_system_ticks();
+		for (i = 0; i < length; i++)
+			buffer[i & (SPI_BENCHMARK_CHUNK - 1)] = epd_spi_read(0);
+		result->byte_loop = bytes_per_second(length, get_system_ticks() - ticks);
+		ticks = get_system_ticks();
+		for (i = 0; i < length; i += SPI_BENCHMARK_CHUNK)
+			epd_spi_read_block(buffer, SPI_BENCHMARK_CHUNK, 0);
+		result->block = bytes_per_second(length, get_system_ticks() - ticks);
+	}
+	return TRUE;
+}
+#endif
+
 #if (defined COG_V230_G2)
 /**
 * \brief SPI command
@@ -301,9 +859,7 @@ void epd_spi_send (unsigned char register_index, unsigned char *register_data,
 	EPD_cs_low ();
 
 	epd_spi_write (0x72); // header of Register Data of write command
-	while(length--) {
-		epd_spi_write (*register_data++);
-	}
+	epd_spi_write_block (register_data, length);
 	EPD_cs_high ();
 }
 
@@ -329,105 +885,156 @@ void epd_spi_send_byte (uint8_t register_index, uint8_t register_data) {
 //******************************************************************
 //* Temperature sensor  Configuration
 //******************************************************************
-// ADC10 interrupt service routine
-#pragma vector=ADC10_VECTOR
-__interrupt void ADC10_ISR(void) {
-	__bic_SR_register_on_exit(CPUOFF);
-	// Clear CPUOFF bit from 0(SR)
-}
 #ifdef __Internal_Temperature_Sensor
+#define TEMPERATURE_ADC_CTL0	(SREF_1 + ADC10SHT_3)
+#define TEMPERATURE_ADC_CTL1	(INCH_10 + ADC10DIV_3) // Temp Sensor ADC10CLK/4
+#elif defined __External_Temperature_Sensor
+#define TEMPERATURE_ADC_CTL0	(SREF_1 + ADC10SHT_3 + REF2_5V)
+#define TEMPERATURE_ADC_CTL1	(INCH_4 + ADC10DIV_3) // input A1.4
+#endif
+/** The reference and ADC are powered on for each sample only */
+#define TEMPERATURE_ADC_ON		(REFON + ADC10ON)
+
+/** The smoothed ADC value of temperature sensor, 4 fraction bits */
+static volatile uint16_t temperature_adc;
+static uint8_t temperature_is_sampled;
+static uint8_t temperature_sample_count;
+
 /**
- * \brief Get temperature value from ADC
+ * \brief Start sampling temperature in background
  *
- * \return the Celsius temperature
+ * \note
+ * - It is called by every overflow of system time base, the conversion
+ *   starts every TEMPERATURE_SAMPLE_PERIOD overflows.
+ * - The reference and ADC are powered on one overflow (32mSec at least)
+ *   before the conversion, it is much longer than the settling time of
+ *   reference (30uSec). They are powered off after the conversion.
  */
-int16_t get_temperature(void) {
-	const uint8_t DegCOffset=0;
-	long temp;
-	float IntDegC;
-
-	ADC10CTL1 = INCH_10 + ADC10DIV_3; // Temp Sensor ADC10CLK/4
-	ADC10CTL0 = SREF_1 + ADC10SHT_3 + REFON + ADC10ON+ADC10IE;
-	ADC10CTL0 |= ENC + ADC10SC;// Sampling and conversion start
-	__bis_SR_register(CPUOFF + GIE);// LPM0, ADC10_ISR will force exit
-	// oC = ((A10/1024)*1500mV)-986mV)*1/3.55mV = A10*423/1024 - 278
-	temp = ADC10MEM;
-
-	ADC10CTL0 |= ENC + ADC10SC;// Sampling and conversion start
-	__bis_SR_register(CPUOFF + GIE);// LPM0, ADC10_ISR will force exit
-	temp = ADC10MEM;
-	ADC10CTL0 |= ENC + ADC10SC;// Sampling and conversion start
-	__bis_SR_register(CPUOFF + GIE);// LPM0, ADC10_ISR will force exit
-	temp += ADC10MEM;
-	temp=temp/2;
-
-	IntDegC =(long)((long)(temp*423)/1024)-(278+DegCOffset);//(long)((long)(temp - 673) * 423) / 1024;
-
-	__no_operation();// SET BREAKPOINT HERE
+static void sample_temperature(void) {
+	if(!temperature_is_sampled) return;
+	if((++temperature_sample_count)<TEMPERATURE_SAMPLE_PERIOD-1) return;
+	if(temperature_sample_count==TEMPERATURE_SAMPLE_PERIOD-1) {
+		ADC10CTL0 |= TEMPERATURE_ADC_ON;
+		return;
+	}
+	temperature_sample_count=0;
+	ADC10CTL0 |= ENC + ADC10SC; // Sampling and conversion start
+}
 
-	return (int8_t) IntDegC;
+// ADC10 interrupt service routine
+#pragma vector=ADC10_VECTOR
+__interrupt void ADC10_ISR(void) {
+	/* Exponential smoothing: adc = adc*(1-1/2^k) + sample*16/2^k */
+	temperature_adc = temperature_adc - (temperature_adc >> TEMPERATURE_SMOOTH_SHIFT) +
+	                  ((ADC10MEM << 4) >> TEMPERATURE_SMOOTH_SHIFT);
+	/* REFON and ADC10ON can be changed only if ENC is cleared */
+	ADC10CTL0 &= ~ENC;
+	ADC10CTL0 &= ~TEMPERATURE_ADC_ON;
 }
-#elif defined __External_Temperature_Sensor
 
 /**
- * \brief Get temperature value from ADC
+ * \brief Get temperature value from the smoothed ADC value
+ *
+ * \note It returns immediately, the ADC is sampled in background.
  *
  * \return the Celsius temperature
  */
 int16_t get_temperature(void) {
-	float IntDegC;
+	uint32_t temp = temperature_adc;
+#ifdef __Internal_Temperature_Sensor
+	const uint8_t DegCOffset=0;
+	// oC = ((A10/1024)*1500mV)-986mV)*1/3.55mV = A10*423/1024 - 278
+	return (int16_t)((temp * 423) / (1024 * 16)) - (278 + DegCOffset);
+#elif defined __External_Temperature_Sensor
 	const uint8_t DegCOffset = 2;
-	long temp;
-	ADC10CTL0 |= ENC + ADC10SC; // Sampling and conversion start
-	__bis_SR_register(CPUOFF + GIE);
-	// LPM0, ADC10_ISR will force exit
-	temp = ADC10MEM;
-
-	ADC10CTL0 |= ENC + ADC10SC; // Sampling and conversion start
-	__bis_SR_register(CPUOFF + GIE);
-	// LPM0, ADC10_ISR will force exit
-	temp = ADC10MEM;
-	ADC10CTL0 |= ENC + ADC10SC; // Sampling and conversion start
-	__bis_SR_register(CPUOFF + GIE);
-	// LPM0, ADC10_ISR will force exit
-	temp = ADC10MEM;
-	ADC10CTL0 |= ENC + ADC10SC; // Sampling and conversion start
-	__bis_SR_register(CPUOFF + GIE);
-	// LPM0, ADC10_ISR will force exit
-	temp = ADC10MEM;
-
 	//org
 	/*
 	 temp = (ADC10MEM*5)/2;
 	 voltage = (float)((float)temp*2.5)/1024.0;			//(2.5/1024)*ADC=Mcu voltage,Temperature voltage=Mcu voltage*2
 	 IntDegC=100.0- (((voltage*1000)/10.77)-111.3);		//100-((Temperature voltage-1.199)*1000)/10.77=IntDegC
-	 __no_operation();					  // SET BREAKPOINT HERE
 	 */
 	//adj
-	// IntDegC=(203-DegCOffset)-((long)((7*temp)/128)+(temp/2));
-	IntDegC = (201 - DegCOffset) - ((long) ((5 * temp) / 128) + (temp / 2));
-	return (int16_t) IntDegC;
-}
-
+	// IntDegC = (201 - DegCOffset) - ((5 * temp) / 128 + (temp / 2));
+	return (int16_t)(201 - DegCOffset) - (int16_t)((5 * temp) / (128 * 16) + temp / (2 * 16));
 #endif
+}
 
 /**
  * \brief Initialize the temperature sensor
+ *
+ * \note The first samples are converted here to settle the reference and
+ *       start the smoothed value, then the ADC samples in background and the
+ *       reference is powered off between samples.
  */
 void initialize_temperature(void) {
-#ifdef __External_Temperature_Sensor
+	uint8_t i;
+	if(temperature_is_sampled) return;
+	ADC10CTL0 = TEMPERATURE_ADC_CTL0 + TEMPERATURE_ADC_ON;
+	ADC10CTL1 = TEMPERATURE_ADC_CTL1;
+	for(i=0; i<4; i++) {
+		ADC10CTL0 |= ENC + ADC10SC; // Sampling and conversion start
+		while (!(ADC10CTL0 & ADC10IFG));
+		ADC10CTL0 &= ~ADC10IFG;
+	}
+	temperature_adc = ADC10MEM << 4;
+	ADC10CTL0 &= ~ENC;
+	ADC10CTL0 = TEMPERATURE_ADC_CTL0 + ADC10IE; // interrupt enabled, powered off
+	temperature_sample_count = 0;
+	temperature_is_sampled = TRUE;
+}
 
-	ADC10CTL0 = SREF_1 + ADC10SHT_3 + ADC10ON + ADC10IE + REFON + REF2_5V; // ADC10ON, interrupt enabled
-	ADC10CTL1 = INCH_4 + ADC10DIV_3; // input A1.4
+/**
+ * \brief Read data from information memory segment of MCU
+ *
+ * \param data The buffer to store the data
+ * \param length The length of data, 64 bytes at most
+ */
+void read_info_flash(void *data,uint8_t length) {
+	memcpy(data,(void *)INFO_FLASH_ADDRESS,length);
+}
 
-#endif
+/**
+ * \brief Erase information memory segment of MCU and write data to it
+ *
+ * \note
+ * - The flash timing generator runs at MCLK/40=400KHz.
+ * - The CPU holds about 13mSec while erasing, interrupts are disabled meanwhile.
+ *
+ * \param data The data to write
+ * \param length The length of data, 64 bytes at most
+ */
+void write_info_flash(const void *data,uint8_t length) {
+	uint8_t *flash_ptr=(uint8_t *)INFO_FLASH_ADDRESS;
+	const uint8_t *source=(const uint8_t *)data;
+	unsigned short state = __get_interrupt_state();
+	__disable_interrupt();
+	/* The flash timing generator runs at 257~476KHz */
+	if (get_MCU_clock() == MCU_CLOCK_RUN) FCTL2 = FWKEY + FSSEL_1 + FN5 + FN2 + FN1 + FN0; // MCLK/40
+	else FCTL2 = FWKEY + FSSEL_1 + FN1; // MCLK/3
+	FCTL3 = FWKEY;         // Clear Lock bit
+	FCTL1 = FWKEY + ERASE; // Set Erase bit
+	*flash_ptr = 0;        // Dummy write to erase segment
+	FCTL1 = FWKEY + WRT;   // Set WRT bit for write operation
+	while (length--) {
+		*flash_ptr++ = *source++;
+	}
+	FCTL1 = FWKEY;         // Clear WRT bit
+	FCTL3 = FWKEY + LOCK;  // Set LOCK bit
+	__set_interrupt_state(state);
 }
 
 /**
  * \brief Initialize the EPD hardware setting
+ *
+ * \note The GPIO is configured by the first call only, the later calls set
+ *       the pins to the state before powering on COG.
  */
 void EPD_display_hardware_init(void) {
-	EPD_initialize_gpio();
+	SPI_BUS_COUNT(inits);
+	if (!hardware_is_initialized) {
+		EPD_initialize_gpio();
+		hardware_is_initialized = TRUE;
+	}
 	EPD_Vcc_turn_off();
 	epd_spi_init();
 	initialize_temperature();
@@ -436,6 +1043,6 @@ void EPD_display_hardware_init(void) {
 	EPD_rst_low();
 	EPD_discharge_low();
 	EPD_border_low();
-	//initialize_EPD_timer();
+	initialize_EPD_timer();
 }
 
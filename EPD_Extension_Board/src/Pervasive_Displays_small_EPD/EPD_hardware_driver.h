@@ -37,8 +37,45 @@
 #include "Pervasive_Displays_small_EPD.h"
 
 #define SMCLK_FREQ			(16000000)
+
+/** The calibrated DCO frequency of set_MCU_frequency */
+#define DCO_1MHz  0
+#define DCO_8MHz  1
+#define DCO_12MHz 2
+#define DCO_16MHz 3
+
+/** The clock of MCU, MCLK and SMCLK are both DCO */
+#define MCU_CLOCK_RUN		0 /**< DCO 16MHz (SMCLK_FREQ) for computing and SPI streaming */
+#define MCU_CLOCK_WAIT		1 /**< DCO 1MHz for long waits and idle */
+#define MCU_CLOCK_WAIT_FREQ	(1000000)
+
+/** The delay runs at MCU_CLOCK_WAIT if it is not shorter than this mSec */
+#define MCU_CLOCK_WAIT_MIN_MS	4
+
+/** Timer0_A runs continuously by SMCLK/8 as system time base */
+#define SYSTEM_TICKS_PER_MS	(SMCLK_FREQ/8000)
+#if (SYSTEM_TICKS_PER_MS != 2000)
+#error "ERROR: get_system_us() and get_system_ms() assume 2 system ticks per uSec."
+#endif
+
+/** The frequency of PWM signal for G1 COG power on, output by Timer1_A CCR1 (TA1.1) */
+#ifndef PWM_FREQ
+#define PWM_FREQ			(250000)
+#endif
+#define PWM_PERIOD_TICKS	(SMCLK_FREQ/PWM_FREQ) /**< SMCLK cycles of one PWM period */
+#if (PWM_PERIOD_TICKS < 2) || (PWM_PERIOD_TICKS > 65535)
+#error "ERROR: PWM_FREQ is out of the range of Timer1_A."
+#endif
 #define __External_Temperature_Sensor
 
+/** The temperature is sampled every 31 overflows of system time base (about 1 second) */
+#define TEMPERATURE_SAMPLE_PERIOD	31
+/** The smoothing factor of temperature is 1/2^TEMPERATURE_SMOOTH_SHIFT */
+#define TEMPERATURE_SMOOTH_SHIFT	3
+
+/** Information memory segment D of MCU stores the parameters learned by COG driver */
+#define INFO_FLASH_ADDRESS	0x1000
+
 /**SPI Defines ****************************************************************/
 #define SPISEL              P1SEL
 #define SPISEL2             P1SEL2
@@ -55,26 +92,95 @@
 #define SPITXIFG			UCB0TXIFG
 #define SPISTAT				UCB0STAT
 #define SPI_baudrate        (SMCLK_FREQ/COG_SPI_baudrate)           /**< the baud rate of SPI */
+#if (SPI_baudrate < 1) || (SPI_baudrate > 255)
+#error "ERROR: COG_SPI_baudrate is out of the range of SPI."
+#endif
+
+#ifndef SPI_BENCHMARK_REPEAT
+#define SPI_BENCHMARK_REPEAT	8  /**< the transfers of each COG line are timed together */
+#endif
+#define SPI_BENCHMARK_CHUNK		64 /**< the buffer size of reading Flash burst */
+#define SPI_BENCHMARK_CASES		4  /**< COG lines of 16, 57 and 111 bytes, 4KB Flash burst */
+
+#if SPI_BENCHMARK
+/** The throughput of one SPI benchmark case */
+typedef struct {
+	uint16_t length;      /**< the bytes of each transfer */
+	uint32_t theoretical; /**< bytes/s at the SPI clock */
+	uint32_t byte_loop;   /**< bytes/s by epd_spi_write or epd_spi_read of each byte */
+	uint32_t block;       /**< bytes/s by the block transfer */
+} SPI_benchmark_t;
+#endif
+
+/** The transitions of shared SPI bus since the update started */
+typedef struct {
+	uint16_t attaches;       /**< calls of epd_spi_attach */
+	uint16_t attach_skipped; /**< attaches which found SPI attached and idle */
+	uint16_t inits;          /**< calls of EPD_display_hardware_init */
+} SPI_bus_statistics_t;
+
+/** The function called by every overflow of system time base */
+typedef void (*EPD_timer_event_handler)(void);
+
+/**
+ * \brief The function called as MCU clock switches, the peripherals clocked by
+ *        SMCLK are set for the new clock in it
+ * \note
+ * - It is called with interrupt disabled, before the switch with is_switched
+ *   FALSE and after it with TRUE.
+ * - Before the switch, it returns FALSE if the peripheral is busy, e.g. UART
+ *   is receiving, then MCU_CLOCK_WAIT is refused. MCU_CLOCK_RUN is never
+ *   refused, the peripheral waits for a short bounded time instead. */
+typedef uint8_t (*MCU_clock_event_handler)(uint8_t MCU_clock, uint8_t is_switched);
+
+/** The time spent at each MCU clock */
+typedef struct {
+	uint32_t time[2];  /**< the mSec at MCU_CLOCK_RUN and MCU_CLOCK_WAIT */
+	uint16_t switches; /**< the number of clock switches */
+} MCU_clock_statistics_t;
 
 void epd_spi_init (void);
 void epd_spi_attach (void);
 void epd_spi_detach (void);
+void reset_SPI_bus_statistics(void);
+#if SPI_BUS_STATISTICS
+const SPI_bus_statistics_t *get_SPI_bus_statistics(void);
+#endif
 void epd_spi_send (unsigned char Register, unsigned char *Data, unsigned Length);
 void epd_spi_send_byte (uint8_t Register, uint8_t Data);
 uint8_t epd_spi_read(unsigned char RDATA);
 void epd_spi_write (unsigned char Data);
 uint8_t epd_spi_write_ex (unsigned char Data);
+void epd_spi_write_block(const uint8_t *data, uint16_t length);
+void epd_spi_read_block(uint8_t *data, uint16_t length, uint8_t dummy);
+void epd_spi_exchange_block(const uint8_t *tx_data, uint8_t *rx_data, uint16_t length);
+#if SPI_BENCHMARK
+uint8_t epd_spi_benchmark(uint8_t index, SPI_benchmark_t *result);
+#endif
+void set_MCU_frequency(uint8_t select_index);
+uint8_t set_MCU_clock(uint8_t MCU_clock);
+uint8_t get_MCU_clock(void);
+void set_MCU_clock_event(MCU_clock_event_handler On_MCU_clock_event);
+#if MCU_CLOCK_SCALING && MCU_CLOCK_STATISTICS
+const MCU_clock_statistics_t *get_MCU_clock_statistics(void);
+#endif
 void sys_delay_ms(unsigned int ms);
 void start_EPD_timer(void);
 void stop_EPD_timer(void);
 uint32_t get_current_time_tick(void);
 void set_current_time_tick(uint32_t count);
+void set_EPD_timer_event(EPD_timer_event_handler On_EPD_timer_event);
+uint32_t get_system_ticks(void);
+uint32_t get_system_us(void);
+uint32_t get_system_ms(void);
 void PWM_start_toggle(void);
 void PWM_stop_toggle(void);
 void PWM_run(uint16_t time);
 void initialize_temperature(void);
 int16_t get_temperature(void);
 void EPD_display_hardware_init (void);
+void read_info_flash(void *data,uint8_t length);
+void write_info_flash(const void *data,uint8_t length);
 
 #if (defined COG_V230_G2)
 uint8_t SPI_R(uint8_t Register, uint8_t Data);
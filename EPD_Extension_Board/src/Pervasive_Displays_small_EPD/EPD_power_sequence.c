@@ -0,0 +1,196 @@
+/**
+* \file
+*
+* \brief The table-driven power sequence engine of COG driver
+*
+* Copyright (c) 2012-2014 Pervasive Displays Inc. All rights reserved.
+*
+*  Authors: Pervasive Displays Inc.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*  1. Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*  2. Redistributions in binary form must reproduce the above copyright
+*     notice, this list of conditions and the following disclaimer in
+*     the documentation and/or other materials provided with the
+*     distribution.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "EPD_power_sequence.h"
+
+#if EPD_POWER_PROFILE
+static struct EPD_power_profile_t power_profile;
+
+/**
+ * \brief Get the timing profile of the last run power sequence
+ */
+const struct EPD_power_profile_t *EPD_power_sequence_profile(void) {
+	return &power_profile;
+}
+#endif
+
+/**
+ * \brief Set the GPIO of power sequence
+ *
+ * \param gpio The GPIO, SEQ_VCC, SEQ_CS...
+ * \param level 1=high, 0=low
+ */
+static void set_gpio(uint8_t gpio,uint8_t level) {
+	switch(gpio) {
+		case SEQ_VCC:
+			if(level) EPD_Vcc_turn_on();
+			else EPD_Vcc_turn_off();
+			break;
+		case SEQ_CS:
+			if(level) EPD_cs_high();
+			else EPD_cs_low();
+			break;
+		case SEQ_BORDER:
+			if(level) EPD_border_high();
+			else EPD_border_low();
+			break;
+		case SEQ_RST:
+			if(level) EPD_rst_high();
+			else EPD_rst_low();
+			break;
+		case SEQ_DISCHARGE:
+			if(level) EPD_discharge_high();
+			else EPD_discharge_low();
+			break;
+		case SEQ_SPI_BUS:
+			if(level) epd_spi_attach();
+			else epd_spi_detach();
+			break;
+	}
+}
+
+#if (defined COG_V230_G2)
+/**
+ * \brief Read register until (register & mask) == value or time out
+ *
+ * \param step The poll step
+ * \return 1 if the register matches
+ */
+static uint8_t poll_register(const struct EPD_power_step_t *step) {
+	uint32_t start_ticks=get_system_ticks();
+	while((SPI_R(step->reg,0x00) & step->mask) != step->value) {
+		if((get_system_ticks()-start_ticks)>=(uint32_t)step->time*SYSTEM_TICKS_PER_MS) return FALSE;
+		delay_ms(1);
+	}
+	return TRUE;
+}
+#endif
+
+/**
+ * \brief Run a power sequence of COG
+ *
+ * \note
+ * - The loop and retry steps share one counter, so they can't be nested.
+ * - The time of each step is recorded if EPD_POWER_PROFILE is 1.
+ *
+ * \param sequence The steps ended by SEQ_END()
+ * \param EPD_type_index The defined EPD size
+ * \return RES_OK or the error code of failed step
+ */
+uint8_t EPD_power_sequence_run(const struct EPD_power_step_t *sequence,uint8_t EPD_type_index) {
+	const struct EPD_power_step_t *step=sequence;
+	uint8_t is_ready=TRUE,repeat=0;
+	uint16_t k;
+#if EPD_POWER_PROFILE
+	uint32_t start_ticks=get_system_ticks(),step_ticks;
+	uint16_t index,step_time;
+	memset(&power_profile,0,sizeof(power_profile));
+	power_profile.attempts=1;
+#endif
+	while(step->op!=SEQ_OP_END) {
+#if EPD_POWER_PROFILE
+		step_ticks=get_system_ticks();
+		index=step-sequence;
+#endif
+		switch(step->op) {
+			case SEQ_OP_SPI:
+				epd_spi_send_byte(step->reg,step->value);
+				break;
+			case SEQ_OP_SPI2:
+				epd_spi_send(step->reg,(uint8_t *)&step->value,2);
+				break;
+			case SEQ_OP_SPI_CHANNEL:
+				epd_spi_send(step->reg,(uint8_t *)&COG_parameters[EPD_type_index].channel_select,8);
+				break;
+			case SEQ_OP_SPI_VOLTAGE:
+				epd_spi_send_byte(step->reg,COG_parameters[EPD_type_index].voltage_level);
+				break;
+#if (defined COG_V230_G2)
+			case SEQ_OP_CHECK:
+				if((SPI_R(step->reg,0x00) & step->mask) != step->value) return step->error;
+				break;
+			case SEQ_OP_POLL:
+				is_ready=poll_register(step);
+				break;
+#endif
+			case SEQ_OP_RETRY:
+				if(!is_ready) {
+					if((++repeat)>=step->value) return step->error;
+#if EPD_POWER_PROFILE
+					power_profile.attempts=repeat+1;
+#endif
+					step-=step->reg;
+					continue;
+				}
+				repeat=0;
+				break;
+			case SEQ_OP_LOOP:
+				if((++repeat)<step->value) {
+					step-=step->reg;
+					continue;
+				}
+				repeat=0;
+				break;
+			case SEQ_OP_BUSY:
+				k=0;
+				while (EPD_IsBusy()) {
+					if((k++) >= 0x0FFF) return step->error;
+				}
+				break;
+			case SEQ_OP_DELAY:
+				delay_ms(step->time);
+				break;
+			case SEQ_OP_PWM:
+				PWM_run(step->time);
+				break;
+			case SEQ_OP_GPIO:
+				set_gpio(step->reg,step->value);
+				break;
+			case SEQ_OP_SIZE:
+				if(!(step->mask & (1<<EPD_type_index))) step+=step->reg;
+				break;
+		}
+#if EPD_POWER_PROFILE
+		if(index<EPD_POWER_PROFILE_STEPS) {
+			step_time=power_profile.step_time[index]+(get_system_ticks()-step_ticks)/SYSTEM_TICKS_PER_MS;
+			power_profile.step_time[index]=(step_time>0xFF) ? 0xFF : step_time;
+		}
+		power_profile.steps++;
+#endif
+		step++;
+	}
+#if EPD_POWER_PROFILE
+	power_profile.total_time=(get_system_ticks()-start_ticks)/SYSTEM_TICKS_PER_MS;
+#endif
+	return RES_OK;
+}
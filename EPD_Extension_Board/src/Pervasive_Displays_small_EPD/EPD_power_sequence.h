@@ -0,0 +1,116 @@
+/**
+* \file
+*
+* \brief The table-driven power sequence engine of COG driver
+*
+* Copyright (c) 2012-2014 Pervasive Displays Inc. All rights reserved.
+*
+*  Authors: Pervasive Displays Inc.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*  1. Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*  2. Redistributions in binary form must reproduce the above copyright
+*     notice, this list of conditions and the following disclaimer in
+*     the documentation and/or other materials provided with the
+*     distribution.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef EPD_POWER_SEQUENCE_H_INCLUDED
+#define EPD_POWER_SEQUENCE_H_INCLUDED
+
+#include "Pervasive_Displays_small_EPD.h"
+
+/**
+ * \brief The operations of power sequence step */
+enum EPD_power_op {
+	SEQ_OP_END,         /**< end of sequence, return RES_OK */
+	SEQ_OP_SPI,         /**< write value to register */
+	SEQ_OP_SPI2,        /**< write value and mask as two data bytes to register */
+	SEQ_OP_SPI_CHANNEL, /**< write Channel Select of EPD size to register */
+	SEQ_OP_SPI_VOLTAGE, /**< write Voltage Level of EPD size to register */
+	SEQ_OP_CHECK,       /**< return error if (register & mask) != value, G2 only */
+	SEQ_OP_POLL,        /**< read register until (register & mask) == value or time ms, G2 only */
+	SEQ_OP_RETRY,       /**< go back reg steps if the last poll failed, return error after value attempts */
+	SEQ_OP_LOOP,        /**< go back reg steps, run the steps value times in total */
+	SEQ_OP_BUSY,        /**< wait for BUSY low, return error if time out */
+	SEQ_OP_DELAY,       /**< delay time ms */
+	SEQ_OP_PWM,         /**< toggle PWM for time ms */
+	SEQ_OP_GPIO,        /**< set GPIO reg to level value */
+	SEQ_OP_SIZE         /**< skip next reg steps if the bit of EPD size is not in mask */
+};
+
+/**
+ * \brief The GPIOs which can be set by power sequence */
+enum EPD_power_gpio {
+	SEQ_VCC,       /**< COG Vcc */
+	SEQ_CS,        /**< COG /CS */
+	SEQ_BORDER,    /**< BORDER */
+	SEQ_RST,       /**< COG /RESET */
+	SEQ_DISCHARGE, /**< external discharge */
+	SEQ_SPI_BUS    /**< 1=attach SPI, 0=detach SPI */
+};
+
+/**
+ * \brief One step of power sequence
+ * \note The meaning of fields depends on op, use the SEQ_xxx macros below to define a step. */
+struct EPD_power_step_t {
+	uint8_t op;    /**< the operation of step */
+	uint8_t reg;   /**< the register index, GPIO or the number of steps */
+	uint8_t value; /**< the data, level or the expected value */
+	uint8_t mask;  /**< the second data byte or the mask */
+	uint8_t time;  /**< the time in mSec */
+	uint8_t error; /**< the returned error code */
+};
+
+#define SEQ_END()                    {SEQ_OP_END,0,0,0,0,0}
+#define SEQ_SPI(reg,data)            {SEQ_OP_SPI,reg,data,0,0,0}
+#define SEQ_SPI2(reg,data0,data1)    {SEQ_OP_SPI2,reg,data0,data1,0,0}
+#define SEQ_SPI_CHANNEL(reg)         {SEQ_OP_SPI_CHANNEL,reg,0,0,0,0}
+#define SEQ_SPI_VOLTAGE(reg)         {SEQ_OP_SPI_VOLTAGE,reg,0,0,0,0}
+#define SEQ_CHECK(reg,mask,value,error) {SEQ_OP_CHECK,reg,value,mask,0,error}
+#define SEQ_POLL(reg,mask,value,ms)  {SEQ_OP_POLL,reg,value,mask,ms,0}
+#define SEQ_RETRY(steps,attempts,error) {SEQ_OP_RETRY,steps,attempts,0,0,error}
+#define SEQ_LOOP(steps,times)        {SEQ_OP_LOOP,steps,times,0,0,0}
+#define SEQ_BUSY(error)              {SEQ_OP_BUSY,0,0,0,0,error}
+#define SEQ_DELAY(ms)                {SEQ_OP_DELAY,0,0,0,ms,0}
+#define SEQ_PWM(ms)                  {SEQ_OP_PWM,0,0,0,ms,0}
+#define SEQ_GPIO(gpio,level)         {SEQ_OP_GPIO,gpio,level,0,0,0}
+#define SEQ_SIZE(size_mask,steps)    {SEQ_OP_SIZE,steps,0,size_mask,0,0}
+
+/**
+ * \brief The maximum steps of a sequence are recorded in profile */
+#ifndef EPD_POWER_PROFILE_STEPS
+#define EPD_POWER_PROFILE_STEPS 32
+#endif
+
+#if EPD_POWER_PROFILE
+/**
+ * \brief Timing profile of the last run power sequence */
+struct EPD_power_profile_t {
+	uint16_t total_time; /**< the time in mSec of whole sequence */
+	uint8_t  attempts;   /**< the attempts of the last retry step */
+	uint8_t  steps;      /**< the number of run steps */
+	uint8_t  step_time[EPD_POWER_PROFILE_STEPS]; /**< the time in mSec of each step, 255 at most */
+};
+const struct EPD_power_profile_t *EPD_power_sequence_profile(void);
+#endif
+
+uint8_t EPD_power_sequence_run(const struct EPD_power_step_t *sequence,uint8_t EPD_type_index);
+
+#endif	//EPD_POWER_SEQUENCE_H_INCLUDED
@@ -0,0 +1,121 @@
+/**
+* \file
+*
+* \brief The temperature compensated stage time model of COG driver
+*
+* Copyright (c) 2012-2014 Pervasive Displays Inc. All rights reserved.
+*
+*  Authors: Pervasive Displays Inc.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*  1. Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*  2. Redistributions in binary form must reproduce the above copyright
+*     notice, this list of conditions and the following disclaimer in
+*     the documentation and/or other materials provided with the
+*     distribution.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "EPD_temperature_model.h"
+
+static EPD_temperature_model_handler _On_load_temperature_model;
+
+/**
+ * \brief Check the temperature model can be used
+ *
+ * \param model The temperature model
+ * \return TRUE if the count is in range and the breakpoints are ascending
+ */
+uint8_t EPD_temperature_model_is_valid(const struct EPD_temperature_model_t *model) {
+	uint8_t i,count;
+	count=model->format & TEMPERATURE_MODEL_COUNT_MASK;
+	if(count==0 || count>TEMPERATURE_MODEL_POINTS) return FALSE;
+	if(model->format & ~(TEMPERATURE_MODEL_COUNT_MASK|TEMPERATURE_MODEL_LINEAR)) return FALSE;
+	for(i=1; i<count; i++) {
+		if(model->temperature[i]<=model->temperature[i-1]) return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * \brief Get the stage time of temperature from temperature model
+ *
+ * \param model The valid temperature model
+ * \param temperature The Celsius temperature
+ * \return the stage time in mSec
+ */
+uint16_t EPD_temperature_model_time(const struct EPD_temperature_model_t *model,int16_t temperature) {
+	uint8_t i,count;
+	int16_t t0,t1;
+	int32_t time0,time1;
+	count=model->format & TEMPERATURE_MODEL_COUNT_MASK;
+	for(i=0; i<count; i++) {
+		if(temperature<=model->temperature[i]) break;
+	}
+	if(!(model->format & TEMPERATURE_MODEL_LINEAR)) return model->time[i];
+	if(i==0) return model->time[0];
+	if(i==count) return model->time[count-1];
+	
+	/* Interpolate between breakpoint i-1 and i */
+	t0=model->temperature[i-1];
+	t1=model->temperature[i];
+	time0=model->time[i-1];
+	time1=model->time[i];
+	return (uint16_t)(time0+((time1-time0)*(temperature-t0))/(t1-t0));
+}
+
+/**
+ * \brief Set the function to load temperature model
+ *
+ * \param On_load_temperature_model The function, NULL to use built-in model
+ */
+void EPD_set_temperature_model_handler(EPD_temperature_model_handler On_load_temperature_model) {
+	_On_load_temperature_model=On_load_temperature_model;
+}
+
+/**
+ * \brief Get the active temperature model of EPD size
+ *
+ * \note The model is loaded to the storage of caller each time, no RAM is kept
+ *       for it. The built-in model is copied if no valid model is loaded.
+ *
+ * \param EPD_type_index The defined EPD size
+ * \param model Return the temperature model
+ * \return TRUE if it is the loaded model
+ */
+uint8_t EPD_get_temperature_model(uint8_t EPD_type_index,struct EPD_temperature_model_t *model) {
+	if(_On_load_temperature_model!=NULL &&
+	   _On_load_temperature_model(EPD_type_index,model) &&
+	   EPD_temperature_model_is_valid(model)) return TRUE;
+	memcpy((uint8_t *)model,(const uint8_t *)&EPD_temperature_model_default[EPD_type_index],
+	       sizeof(struct EPD_temperature_model_t));
+	return FALSE;
+}
+
+/**
+ * \brief Get the stage time of temperature from the active temperature model
+ *
+ * \param EPD_type_index The defined EPD size
+ * \param temperature The Celsius temperature
+ * \return the stage time in mSec
+ */
+uint16_t EPD_get_temperature_time(uint8_t EPD_type_index,int16_t temperature) {
+	struct EPD_temperature_model_t model;
+	EPD_get_temperature_model(EPD_type_index,&model);
+	return EPD_temperature_model_time(&model,temperature);
+}
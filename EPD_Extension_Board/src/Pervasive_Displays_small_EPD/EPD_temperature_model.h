@@ -0,0 +1,78 @@
+/**
+* \file
+*
+* \brief The temperature compensated stage time model of COG driver
+*
+* Copyright (c) 2012-2014 Pervasive Displays Inc. All rights reserved.
+*
+*  Authors: Pervasive Displays Inc.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*  1. Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*  2. Redistributions in binary form must reproduce the above copyright
+*     notice, this list of conditions and the following disclaimer in
+*     the documentation and/or other materials provided with the
+*     distribution.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef EPD_TEMPERATURE_MODEL_H_INCLUDED
+#define EPD_TEMPERATURE_MODEL_H_INCLUDED
+
+#include "Pervasive_Displays_small_EPD.h"
+
+/** The maximum breakpoints of temperature model */
+#define TEMPERATURE_MODEL_POINTS	7
+
+/** The bits of format of temperature model */
+#define TEMPERATURE_MODEL_COUNT_MASK	0x0F /**< the number of breakpoints */
+#define TEMPERATURE_MODEL_LINEAR		0x80 /**< interpolate between breakpoints, or step */
+
+/**
+ * \brief The stage time of COG driver by temperature
+ *
+ * \note
+ * - Step: time[i] is used if temperature[i-1] < T <= temperature[i], time[count]
+ *   is used if T is above the last breakpoint.
+ * - Linear: time[i] is the time at temperature[i], the time between breakpoints
+ *   is interpolated and the time out of breakpoints is the time of nearest one.
+ * - The breakpoints must be ascending.
+ * - The layout is the same in external Flash and UART packet (little endian, 24 bytes).
+ */
+struct EPD_temperature_model_t {
+	uint16_t time[TEMPERATURE_MODEL_POINTS+1];   /**< the stage time in mSec */
+	int8_t   temperature[TEMPERATURE_MODEL_POINTS]; /**< the breakpoints in Celsius */
+	uint8_t  format;                                /**< count of breakpoints and TEMPERATURE_MODEL_LINEAR */
+};
+
+/**
+ * \brief Developer can create an external function to load temperature model,
+ *        it returns TRUE if model is loaded */
+typedef uint8_t (*EPD_temperature_model_handler)(uint8_t EPD_type_index,
+		struct EPD_temperature_model_t *model);
+
+/** The built-in temperature model of each EPD size, defined by COG driver */
+extern const struct EPD_temperature_model_t EPD_temperature_model_default[COUNT_OF_EPD_TYPE];
+
+uint8_t EPD_temperature_model_is_valid(const struct EPD_temperature_model_t *model);
+uint16_t EPD_temperature_model_time(const struct EPD_temperature_model_t *model,int16_t temperature);
+void EPD_set_temperature_model_handler(EPD_temperature_model_handler On_load_temperature_model);
+uint8_t EPD_get_temperature_model(uint8_t EPD_type_index,struct EPD_temperature_model_t *model);
+uint16_t EPD_get_temperature_time(uint8_t EPD_type_index,int16_t temperature);
+
+#endif	//EPD_TEMPERATURE_MODEL_H_INCLUDED
@@ -81,6 +81,8 @@ enum EPD_SIZE {
 #include "EPD_hardware_gpio.h"
 #include "EPD_hardware_driver.h"
 #include "EPD_COG_process.h"
+#include "EPD_power_sequence.h"
+#include "EPD_temperature_model.h"
 #include "EPD_controller.h"
 
 #endif	//EPAPER_H_INCLUDED
@@ -47,11 +47,58 @@
  * - Options are COG_V110_G1 and COG_V230_G2 */
 #define COG_V110_G1
 
-/** The SPI frequency of this kit (8MHz) */
+/** The SPI frequency of this kit (8MHz), shared by COG and serial Flash
+ * \note Don't exceed SMCLK/2. At SMCLK/1 (16MHz) the half clock period (31nSec) is
+ *       shorter than the MISO setup time of USCI master (50nSec at 3V) plus the
+ *       output valid time of Flash, the data read would be out of the MCU spec. */
 #define COG_SPI_baudrate 8000000
 
-/** Define the number of ram buffer for system packet used interchangeably*/
-#define BUFFER_SIZE	1
+/** Define the number of ram buffer for system packet used interchangeably.
+ * \note Must be power of 2. The RX interrupt fills one buffer while the other
+ *       is handled by main loop. */
+#define BUFFER_SIZE	2
+
+/** Define the size of UART TX ring buffer, must be power of 2 (<=128).
+ * \note It holds one maximum reply packet at least. The Flash readback builds
+ *       the next packet as the buffer is empty, 64 bytes let it build while the
+ *       last packet is being sent but cost 32 bytes RAM. */
+#define UART_TX_BUFFER_SIZE	32
+
+/** Set to 1 to measure the worst-case cycles of UART RX interrupt by Timer1_A.
+ * Read the result by get_rx_isr_max_cycles(). */
+#define UART_RX_ISR_PROFILE 0
+
+/** Set to 1 to count the dropped packets, UART overruns and TX buffer waits.
+ * Read the result by command 0x13. */
+#define UART_LINK_STATISTICS 0
+
+/** Set to 1 to run MCU at 1MHz during long waits and idle, at 16MHz for
+ * computing and SPI streaming.
+ * \note The CPU sleeps in LPM0 only, LPM3 is out of reach by design. The system
+ *       time base, delays, UART and PWM are clocked by SMCLK which LPM3 stops,
+ *       and the 32kHz crystal for ACLK is not mounted on LaunchPad by default. */
+#define MCU_CLOCK_SCALING 1
+
+/** Set to 1 to record the time spent at each MCU clock of MCU_CLOCK_SCALING.
+ * Read the result by get_MCU_clock_statistics() or command 0x18. */
+#define MCU_CLOCK_STATISTICS 0
+
+/** Set to 1 to record the time of each step of COG power sequences.
+ * Read the result of the last sequence by EPD_power_sequence_profile(). */
+#define EPD_POWER_PROFILE 0
+
+/** Set to 1 to measure the throughput of SPI transfers of COG lines and Flash
+ * bursts. Read the result by epd_spi_benchmark(). */
+#define SPI_BENCHMARK 0
+
+/** Set to 1 to count the SPI attaches and hardware initializations of each
+ * update. Read the result by get_SPI_bus_statistics(). */
+#define SPI_BUS_STATISTICS 0
+
+/** Define the table size of CRC-16/CCITT for protocol version 2, 16 or 256.
+ * \note 16 entries (32 bytes flash) process a byte by two nibbles. 256 entries
+ *       cost 512 bytes flash and save about half of the CRC time. */
+#define CRC16_TABLE_SIZE	16
 
 /** System Packet length=6~64, maximum=64.
 * The payload length of MSP430 LaunchPad is 32 bytes only.
@@ -51,56 +51,6 @@
 #include "image_data.h"
 #endif
 
-#define DCO_1MHz  0
-#define DCO_8MHz  1
-#define DCO_12MHz 2
-#define DCO_16MHz 3
-
-/**
- * \brief Set CPU work Frequency
- *
- * \param select_index The defined CPU frequency
- * */
-void set_MCU_frequency(uint8_t select_index) {
-
-	switch (select_index) {
-	case DCO_1MHz:
-		if (CALBC1_1MHZ == 0xFF || CALDCO_1MHZ == 0xFF) {
-			while (1)
-				; // If calibration constants erased, do not load, trap CPU.
-		}
-		BCSCTL1 = CALBC1_1MHZ; // Set range
-		DCOCTL = CALDCO_1MHZ; // Set DCO step + modulation */
-		break;
-	case DCO_8MHz:
-		if (CALBC1_8MHZ == 0xFF || CALDCO_8MHZ == 0xFF) {
-			while (1)
-				;
-		}
-		BCSCTL1 = CALBC1_8MHZ;
-		DCOCTL = CALDCO_8MHZ;
-		break;
-	case DCO_12MHz:
-		if (CALBC1_12MHZ == 0xFF || CALDCO_12MHZ == 0xFF) {
-			while (1)
-				;
-		}
-		BCSCTL1 = CALBC1_12MHZ;
-		DCOCTL = CALDCO_12MHZ;
-		break;
-	case DCO_16MHz:
-		if (CALBC1_16MHZ == 0xFF || CALDCO_16MHZ == 0xFF) {
-			//Info is missing, guess at a good value.
-			BCSCTL1 = 0x8f; //CALBC1_16MHZ at 0x10f9
-			DCOCTL = 0x9C;  //CALDCO_16MHZ at 0x10f8
-		} else {
-			BCSCTL1 = CALBC1_16MHZ;
-			DCOCTL = CALDCO_16MHZ;
-		}
-		break;
-	}
-}
-
 /**
  * \brief LaunchPad initialization
  */